@@ -105,9 +105,9 @@
 #define ADMUX_THERM_EXTERNAL_SENSOR 0b00001011  // VCC reference (2.5V), Channel PC2
 // Used for Lume1 Driver: MCP9700 - T_Celsius = 100*(VOUT - 0.5V)
 // ADC is 2.5V reference, 0 to 1023
-// FIXME: due to floating point, this calculation takes 916 extra bytes
-//        (should use an integer equivalent instead)
-#define EXTERN_TEMP_FORMULA(m) (((m)-205)/4.09)
+#define EXTERN_TEMP_REF_MV    2500   // ADC reference
+#define EXTERN_TEMP_OFFSET_MV 500    // sensor output at 0 C
+#define EXTERN_TEMP_UV_PER_C  10000  // 10 mV per C
 
 // this driver allows for aux LEDs under the optic
 #define AUXLED_R_PIN    PA5    // pin 2
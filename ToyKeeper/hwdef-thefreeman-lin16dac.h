@@ -48,6 +48,10 @@ Read voltage from VCC pin, has PFET so no drop
 #define LED2_ENABLE_PIN   PIN7_bp
 #define LED2_ENABLE_PORT  PORTA_OUT
 #define LED2_ON_DELAY 80  // how many ms to delay turning on the lights after enabling the channel
+// leave the op-amp on briefly after going to zero, to skip LED2_ON_DELAY
+#define USE_LED_KEEP_WARM
+// ... and turn it on as soon as the button is pressed
+#define USE_LED_PREWARM
 
 // average drop across diode on this hardware
 #ifndef VOLTAGE_FUDGE_FACTOR
@@ -338,6 +338,17 @@ void loop() {
 }
 
 
+#if defined(USE_THERMAL_REGULATION) && defined(USE_THERM_MODEL)
+// like low_voltage(), this covers every mode which doesn't handle
+// EV_temperature_target itself, by capping the level they can set
+void therm_target(uint8_t level) {
+    if (level < MIN_THERM_STEPDOWN) level = MIN_THERM_STEPDOWN;
+    therm_limit_level = level;
+    if (actual_level > level) set_level(level);
+}
+#endif
+
+
 // instead of handling EV_low_voltage in each mode,
 // it's handled globally here to make the code smaller and simpler
 void low_voltage() {
@@ -359,8 +370,17 @@ void low_voltage() {
     // in normal mode, step down or turn off
     else if (state == steady_state) {
         if (actual_level > 1) {
+            #ifdef USE_LVP_REGULATION
+            // lower the target a little at a time and let gradual
+            // adjustment follow, so output settles just above the cutoff
+            // (steady_state raises it again if the voltage recovers)
+            if (! lvp_restore_level) lvp_restore_level = target_level;
+            uint8_t lvl = actual_level - ((actual_level >> 3) + 1);
+            lvp_set_therm_target(lvl);
+            #else
             uint8_t lvl = (actual_level >> 1) + (actual_level >> 2);
             set_level_and_therm_target(lvl);
+            #endif
         }
         else {
             set_state(off_state, 0);
@@ -48,27 +48,54 @@ void indicator_blink(uint8_t arg) {
 
     #endif  // ifdef USE_OLD_BLINKING_INDICATOR
 }
+
+#ifdef USE_STANDBY_DEADLINE
+// like rgb_led_wake(), for a 2-bit indicator mode (off, low, high, blinking)
+void indicator_wake(uint8_t mode) {
+    if (mode == 3) standby_wake_within(1);
+    #ifdef USE_SLEEP_LVP
+    else if (mode) standby_wake_for_lvp();
+    #endif
+}
+#endif
 #endif
 
 #if defined(USE_AUX_RGB_LEDS) && defined(TICK_DURING_STANDBY)
 uint8_t voltage_to_rgb() {
     static const uint8_t levels[] = {
     // voltage, color
-          0, 0, // 0, R
-         33, 1, // 1, R+G
-         35, 2, // 2,   G
-         37, 3, // 3,   G+B
-         39, 4, // 4,     B
-         41, 5, // 5, R + B
-         44, 6, // 6, R+G+B  // skip; looks too similar to G+B
-        255, 6, // 7, R+G+B
+                       0, 0, // 0, R
+        VOLTAGE_STEP(33), 1, // 1, R+G
+        VOLTAGE_STEP(35), 2, // 2,   G
+        VOLTAGE_STEP(37), 3, // 3,   G+B
+        VOLTAGE_STEP(39), 4, // 4,     B
+        VOLTAGE_STEP(41), 5, // 5, R + B
+        VOLTAGE_STEP(44), 6, // 6, R+G+B  // skip; looks too similar to G+B
+                     255, 6, // 7, R+G+B
     };
+    static uint8_t prev_volts = 0;
+    static uint8_t band = 0;  // index of the current color in levels[]
+    #ifdef USE_SOC
+    // state of charge is steadier than a live measurement
+    uint8_t volts = soc_to_voltage();
+    #else
     uint8_t volts = voltage;
+    #endif
     if (volts < VOLTAGE_LOW) return 0;
 
-    uint8_t i;
-    for (i = 0;  volts >= levels[i];  i += 2) {}
-    uint8_t color_num = levels[(i - 2) + 1];
+    // only scan the table when the voltage changes,
+    // and only change color after passing an edge by some margin
+    // (to keep the color from flapping when it's right on an edge)
+    if (volts != prev_volts) {
+        // no margin needed the first time
+        uint8_t margin = prev_volts ? RGB_VOLTAGE_HYSTERESIS : 0;
+        prev_volts = volts;
+        // (the 255 entry alone doesn't stop it, if volts is 255 too)
+        while ((band + 2 < (uint8_t)sizeof(levels))
+               && (volts >= levels[band + 2] + margin)) band += 2;
+        while (band && (volts + margin < levels[band])) band -= 2;
+    }
+    uint8_t color_num = levels[band + 1];
     return pgm_read_byte(rgb_led_colors + color_num);
 }
 
@@ -182,6 +209,22 @@ void rgb_led_update(uint8_t mode, uint8_t arg) {
     #endif
 }
 
+#ifdef USE_STANDBY_DEADLINE
+// ask for standby wakeups as often as the aux LEDs need them:
+// animations need every tick, static colors only need battery checks,
+// and nothing needs to wake up while they're off
+void rgb_led_wake(uint8_t mode) {
+    uint8_t pattern = (mode>>4);
+    uint8_t color = mode & 0x0f;
+    if (! pattern) return;
+    if ((pattern == 3) || (color == 7) || (color == 8))
+        standby_wake_within(1);
+    #ifdef USE_SLEEP_LVP
+    else standby_wake_for_lvp();
+    #endif
+}
+#endif
+
 void rgb_led_voltage_readout(uint8_t bright) {
     uint8_t color = voltage_to_rgb();
     if (bright) color = color << 1;
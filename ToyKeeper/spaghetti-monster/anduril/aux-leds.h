@@ -22,10 +22,21 @@
 
 #if defined(USE_INDICATOR_LED) && defined(TICK_DURING_STANDBY)
 void indicator_blink(uint8_t arg);
+#ifdef USE_STANDBY_DEADLINE
+void indicator_wake(uint8_t mode);
+#endif
 #endif
 #if defined(USE_AUX_RGB_LEDS) && defined(TICK_DURING_STANDBY)
 uint8_t setting_rgb_mode_now = 0;
+// how far past a color's edge the voltage must go to change colors,
+// in volts * 10
+#ifndef RGB_VOLTAGE_HYSTERESIS
+#define RGB_VOLTAGE_HYSTERESIS 1
+#endif
 void rgb_led_update(uint8_t mode, uint8_t arg);
+#ifdef USE_STANDBY_DEADLINE
+void rgb_led_wake(uint8_t mode);
+#endif
 void rgb_led_voltage_readout(uint8_t bright);
 /*
  * 0: R
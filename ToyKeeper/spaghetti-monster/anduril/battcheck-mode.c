@@ -69,11 +69,36 @@ uint8_t battcheck_state(Event event, uint16_t arg) {
 // ...
 // 13 = add 0.30V
 void voltage_config_save(uint8_t step, uint8_t value) {
-    if (value) voltage_correction = value;
+    if (! value) return;
+
+    #ifdef USE_VOLTAGE_CALIBRATION
+    // items 2 and 3: put in a battery of known voltage (one low, one
+    // high), and enter the error at that voltage on the same 1-13 scale
+    // (if only one of them is set, it acts as a simple offset)
+    if (step > 1) {
+        step -= 2;
+        voltage_cal_v[step] = voltage_uncal;
+        voltage_cal_err[step] = value - 7;
+        voltage_cal_update();
+        return;
+    }
+    // item 1: simple offset, which also clears the two-point calibration
+    voltage_cal_v[0] = 0;
+    voltage_cal_v[1] = 0;
+    voltage_cal_update();
+    #endif
+
+    voltage_correction = value;
 }
 
 uint8_t voltage_config_state(Event event, uint16_t arg) {
-    return config_state_base(event, arg, 1, voltage_config_save);
+    return config_state_base(event, arg,
+                             #ifdef USE_VOLTAGE_CALIBRATION
+                             3,
+                             #else
+                             1,
+                             #endif
+                             voltage_config_save);
 }
 #endif  // #ifdef USE_VOLTAGE_CORRECTION
 
@@ -25,6 +25,8 @@ uint8_t battcheck_state(Event event, uint16_t arg);
 #ifdef USE_VOLTAGE_CORRECTION
 void voltage_config_save(uint8_t step, uint8_t value);
 uint8_t voltage_config_state(Event event, uint16_t arg);
+#elif defined(USE_VOLTAGE_CALIBRATION)
+#error "USE_VOLTAGE_CALIBRATION requires USE_VOLTAGE_CORRECTION"
 #endif
 
 
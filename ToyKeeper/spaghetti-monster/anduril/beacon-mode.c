@@ -28,6 +28,18 @@ inline void beacon_mode_iter() {
         set_level(memorized_level);
         nice_delay_ms(100);
         set_level(0);
+        #ifdef USE_WARM_STANDBY
+        // sleep until the next pulse, unless the user is busy clicking
+        // (only with warm standby, or each pulse would reset the
+        //  voltage and temperature history)
+        // (going to sleep would cancel their input)
+        if (! current_event) {
+            // count sleep ticks from zero
+            ticks_since_last_event = 0;
+            go_to_standby = 1;
+            return;
+        }
+        #endif
         nice_delay_ms(((beacon_seconds) * 1000) - 100);
     }
 }
@@ -38,8 +50,21 @@ uint8_t beacon_state(Event event, uint16_t arg) {
         set_state(off_state, 0);
         return MISCHIEF_MANAGED;
     }
-    // TODO: use sleep ticks to measure time between pulses,
-    //       to save power
+    #ifdef USE_WARM_STANDBY
+    // measure time between pulses in sleep ticks, to save power
+    else if (event == EV_sleep_tick) {
+        // time from the end of one pulse to the start of the next
+        // (in 32 bits, since seconds * ticks per minute overflows 16)
+        uint32_t period = (uint32_t)beacon_seconds * SLEEP_TICKS_PER_MINUTE / 60;
+        uint16_t pulse = SLEEP_TICKS_PER_MINUTE / 600;
+        uint16_t wait = (period > pulse) ? (period - pulse) : 0;
+        if (arg >= wait) go_to_standby = 0;  // wake up and blink
+        #ifdef USE_STANDBY_DEADLINE
+        else standby_wake_within(wait - arg);
+        #endif
+        return MISCHIEF_MANAGED;
+    }
+    #endif
 
     // 2 clicks: next blinky mode
     else if (event == EV_2clicks) {
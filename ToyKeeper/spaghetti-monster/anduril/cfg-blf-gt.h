@@ -2,6 +2,9 @@
 #define MODEL_NUMBER "0321"
 #include "hwdef-BLF_GT.h"
 
+// convert voltage with a table instead of a software divide
+#define USE_VOLTAGE_LUT
+
 // the button lights up
 #define USE_INDICATOR_LED
 // the button is visible while main LEDs are on
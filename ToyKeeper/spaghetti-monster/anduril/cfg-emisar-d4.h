@@ -3,6 +3,9 @@
 #include "hwdef-Emisar_D4.h"
 #include "hank-cfg.h"
 
+// convert voltage with a table instead of a software divide
+#define USE_VOLTAGE_LUT
+
 // ../../bin/level_calc.py 1 65 7135 1 0.8 150
 // ... mixed with this:
 // ../../bin/level_calc.py 2 150 7135 4 0.33 150 FET 1 10 1500
@@ -6,6 +6,8 @@
 #undef BLINK_AT_RAMP_MIDDLE
 
 #define USE_DYNAMIC_UNDERCLOCKING
+// sleep during delays instead of spinning
+#define USE_TIMER_DELAY
 
 // 1....15: level_calc.py 3.01 1  15 7135 1 0.1   2 --pwm dyn:15:64:64
 // 16..150: level_calc.py 5.01 1 135 7135 1   2 800 --pwm dyn:49:3072:255:3.0
@@ -88,9 +88,19 @@ typedef enum {
     #ifdef USE_THERMAL_REGULATION
     therm_ceil_e,
     therm_cal_offset_e,
+    #ifdef USE_THERM_AUTOTUNE
+    therm_model_rise_e,
+    therm_model_tau_e,
+    #endif
     #endif
     #ifdef USE_VOLTAGE_CORRECTION
     voltage_correction_e,
+    #ifdef USE_VOLTAGE_CALIBRATION
+    voltage_cal_v0_e,
+    voltage_cal_v1_e,
+    voltage_cal_err0_e,
+    voltage_cal_err1_e,
+    #endif
     #endif
     #ifdef USE_INDICATOR_LED
     indicator_led_mode_e,
@@ -107,7 +117,8 @@ typedef enum {
 #define EEPROM_BYTES eeprom_indexes_e_END
 
 #if defined(START_AT_MEMORIZED_LEVEL) \
-    || defined(START_AT_MEMORIZED_TINT)
+    || defined(START_AT_MEMORIZED_TINT) \
+    || defined(USE_SOC)
 #define USE_EEPROM_WL
 typedef enum {
     #ifdef START_AT_MEMORIZED_LEVEL
@@ -116,6 +127,9 @@ typedef enum {
     #ifdef START_AT_MEMORIZED_TINT
     memorized_tint_e,
     #endif
+    #ifdef USE_SOC
+    soc_e,
+    #endif
     eeprom_wl_indexes_e_END
 } eeprom_wl_indexes_e;
 #define EEPROM_WL_BYTES eeprom_wl_indexes_e_END
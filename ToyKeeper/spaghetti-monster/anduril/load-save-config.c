@@ -88,9 +88,20 @@ void load_config() {
         #ifdef USE_THERMAL_REGULATION
         therm_ceil = eeprom[therm_ceil_e];
         therm_cal_offset = eeprom[therm_cal_offset_e];
+        #ifdef USE_THERM_AUTOTUNE
+        therm_model_rise = eeprom[therm_model_rise_e];
+        therm_model_tau = eeprom[therm_model_tau_e];
+        #endif
         #endif
         #ifdef USE_VOLTAGE_CORRECTION
         voltage_correction = eeprom[voltage_correction_e];
+        #ifdef USE_VOLTAGE_CALIBRATION
+        voltage_cal_v[0] = eeprom[voltage_cal_v0_e];
+        voltage_cal_v[1] = eeprom[voltage_cal_v1_e];
+        voltage_cal_err[0] = eeprom[voltage_cal_err0_e];
+        voltage_cal_err[1] = eeprom[voltage_cal_err1_e];
+        voltage_cal_update();
+        #endif
         #endif
         #ifdef USE_INDICATOR_LED
         indicator_led_mode = eeprom[indicator_led_mode_e];
@@ -104,7 +115,8 @@ void load_config() {
         #endif
     }
     #if defined(START_AT_MEMORIZED_LEVEL) \
-        || defined(START_AT_MEMORIZED_TINT)
+        || defined(START_AT_MEMORIZED_TINT) \
+        || defined(USE_SOC)
     if (load_eeprom_wl()) {
         #ifdef START_AT_MEMORIZED_LEVEL
         memorized_level = eeprom_wl[memorized_level_e];
@@ -112,6 +124,11 @@ void load_config() {
         #ifdef START_AT_MEMORIZED_TINT
         tint = eeprom_wl[memorized_tint_e];
         #endif
+        #ifdef USE_SOC
+        soc_saved = eeprom_wl[soc_e];
+        soc_charge = (uint32_t)soc_saved << 24;
+        soc_known = 1;
+        #endif
     }
     #endif
 }
@@ -180,9 +197,19 @@ void save_config() {
     #ifdef USE_THERMAL_REGULATION
     eeprom[therm_ceil_e] = therm_ceil;
     eeprom[therm_cal_offset_e] = therm_cal_offset;
+    #ifdef USE_THERM_AUTOTUNE
+    eeprom[therm_model_rise_e] = therm_model_rise;
+    eeprom[therm_model_tau_e] = therm_model_tau;
+    #endif
     #endif
     #ifdef USE_VOLTAGE_CORRECTION
     eeprom[voltage_correction_e] = voltage_correction;
+    #ifdef USE_VOLTAGE_CALIBRATION
+    eeprom[voltage_cal_v0_e] = voltage_cal_v[0];
+    eeprom[voltage_cal_v1_e] = voltage_cal_v[1];
+    eeprom[voltage_cal_err0_e] = voltage_cal_err[0];
+    eeprom[voltage_cal_err1_e] = voltage_cal_err[1];
+    #endif
     #endif
     #ifdef USE_INDICATOR_LED
     eeprom[indicator_led_mode_e] = indicator_led_mode;
@@ -199,7 +226,8 @@ void save_config() {
 }
 
 #if defined(START_AT_MEMORIZED_LEVEL) \
-    || defined(START_AT_MEMORIZED_TINT)
+    || defined(START_AT_MEMORIZED_TINT) \
+    || defined(USE_SOC)
 void save_config_wl() {
     #ifdef START_AT_MEMORIZED_LEVEL
     eeprom_wl[memorized_level_e] = memorized_level;
@@ -207,6 +235,10 @@ void save_config_wl() {
     #ifdef START_AT_MEMORIZED_TINT
     eeprom_wl[memorized_tint_e] = tint;
     #endif
+    #ifdef USE_SOC
+    soc_saved = soc_level();
+    eeprom_wl[soc_e] = soc_saved;
+    #endif
     save_eeprom_wl();
 }
 #endif
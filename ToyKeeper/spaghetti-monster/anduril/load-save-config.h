@@ -24,9 +24,13 @@
 void load_config();
 void save_config();
 #if defined(START_AT_MEMORIZED_LEVEL) \
-    || defined(START_AT_MEMORIZED_TINT)
+    || defined(START_AT_MEMORIZED_TINT) \
+    || defined(USE_SOC)
 void save_config_wl();
 #endif
+#ifdef USE_SOC
+uint8_t soc_saved = 0;  // last state of charge written to eeprom
+#endif
 
 
 #endif
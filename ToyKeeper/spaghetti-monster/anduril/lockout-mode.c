@@ -144,8 +144,14 @@ uint8_t lockout_state(Event event, uint16_t arg) {
         if ((indicator_led_mode & 0b00001100) == 0b00001100) {
             indicator_blink(arg);
         }
+        #ifdef USE_STANDBY_DEADLINE
+        indicator_wake(indicator_led_mode >> 2);
+        #endif
         #elif defined(USE_AUX_RGB_LEDS)
         rgb_led_update(aux_mode, arg);
+        #ifdef USE_STANDBY_DEADLINE
+        rgb_led_wake(aux_mode);
+        #endif
         #endif
         return MISCHIEF_MANAGED;
     }
@@ -39,6 +39,14 @@ uint8_t off_state(Event event, uint16_t arg) {
         #ifdef USE_SUNSET_TIMER
         sunset_timer = 0;  // needs a reset in case previous timer was aborted
         #endif
+        #ifdef USE_SOC
+        // remember state of charge, but only after it changes a bit
+        // (to reduce eeprom wear)
+        {
+            int16_t diff = soc_level() - soc_saved;
+            if ((diff > 3) || (diff < -3)) save_config_wl();
+        }
+        #endif
         // sleep while off  (lower power use)
         // (unless delay requested; give the ADC some time to catch up)
         if (! arg) { go_to_standby = 1; }
@@ -61,11 +69,16 @@ uint8_t off_state(Event event, uint16_t arg) {
     else if (event == EV_sleep_tick) {
         #ifdef USE_MANUAL_MEMORY_TIMER
         // reset to manual memory level when timer expires
-        if (manual_memory &&
-                (arg >= (manual_memory_timer * SLEEP_TICKS_PER_MINUTE))) {
-            memorized_level = manual_memory;
-            #ifdef USE_TINT_RAMPING
-            tint = manual_memory_tint;
+        if (manual_memory) {
+            uint16_t ticks = manual_memory_timer * SLEEP_TICKS_PER_MINUTE;
+            if (arg >= ticks) {
+                memorized_level = manual_memory;
+                #ifdef USE_TINT_RAMPING
+                tint = manual_memory_tint;
+                #endif
+            }
+            #ifdef USE_STANDBY_DEADLINE
+            else standby_wake_within(ticks - arg);
             #endif
         }
         #endif
@@ -73,8 +86,14 @@ uint8_t off_state(Event event, uint16_t arg) {
         if ((indicator_led_mode & 0b00000011) == 0b00000011) {
             indicator_blink(arg);
         }
+        #ifdef USE_STANDBY_DEADLINE
+        indicator_wake(indicator_led_mode & 0b00000011);
+        #endif
         #elif defined(USE_AUX_RGB_LEDS)
         rgb_led_update(rgb_led_off_mode, arg);
+        #ifdef USE_STANDBY_DEADLINE
+        rgb_led_wake(rgb_led_off_mode);
+        #endif
         #endif
 
         #ifdef USE_AUTOLOCK
@@ -83,6 +102,9 @@ uint8_t off_state(Event event, uint16_t arg) {
             if ((autolock_time > 0)  && (arg > ticks)) {
                 set_state(lockout_state, 0);
             }
+            #ifdef USE_STANDBY_DEADLINE
+            else if (autolock_time > 0) standby_wake_within(ticks - arg + 1);
+            #endif
         #endif  // ifdef USE_AUTOLOCK
         return MISCHIEF_MANAGED;
     }
@@ -93,6 +115,16 @@ uint8_t off_state(Event event, uint16_t arg) {
         set_level(nearest_ramp_level(1));
         return MISCHIEF_MANAGED;
     }
+    #elif defined(USE_LED_PREWARM)
+    // 1st press: the light will probably turn on soon, so get ready
+    else if (event == EV_click1_press) {
+        uint8_t lvl = memorized_level;
+        #if defined(USE_MANUAL_MEMORY) && !defined(USE_MANUAL_MEMORY_TIMER)
+        if (manual_memory) lvl = manual_memory;
+        #endif
+        led_prewarm(nearest_ramp_level(lvl));
+        return MISCHIEF_MANAGED;
+    }
     #endif  // B_TIMING_ON == B_PRESS_T
     // hold: go to lowest level
     else if (event == EV_click1_hold) {
@@ -303,6 +303,40 @@ uint8_t steady_state(Event event, uint16_t arg) {
         }
         #endif  // ifdef USE_SUNSET_TIMER
 
+        #ifdef USE_LVP_REGULATION
+        // after LVP lowered the target, raise it back up slowly
+        // (about once per second) while the battery can handle it
+        if (lvp_restore_level && (0 == (arg & 63))
+                && (voltage >= VOLTAGE_LOW + LVP_REGULATION_MARGIN)
+                #ifdef USE_VOLTAGE_SAG_COMP
+                && (voltage_loaded >= VOLTAGE_LOW_LOADED + LVP_REGULATION_MARGIN)
+                #endif
+                ) {
+            uint8_t lvl = target_level + 1;
+            // (don't override a thermal step-down in progress)
+            if (gradual_target == target_level) lvp_set_therm_target(lvl);
+            else target_level = lvl;
+            if (lvl >= lvp_restore_level) lvp_restore_level = 0;
+        }
+        #endif
+
+        #ifdef USE_POWER_LIMIT
+        // stay within the sustained power budget
+        if (gradual_target > power_limit_level) {
+            if (! power_limit_restore) power_limit_restore = gradual_target;
+            set_level_gradually(power_limit_level);
+        }
+        // go back to the previous level when the budget recovers
+        // (but not above the thermal target)
+        else if (power_limit_restore
+                && (power_limit_level > power_limit_restore)) {
+            uint8_t lvl = power_limit_restore;
+            if (lvl > target_level) lvl = target_level;
+            set_level_gradually(lvl);
+            power_limit_restore = 0;
+        }
+        #endif
+
         #ifdef USE_SET_LEVEL_GRADUALLY
         int16_t diff = gradual_target - actual_level;
         static uint16_t ticks_since_adjust = 0;
@@ -336,7 +370,25 @@ uint8_t steady_state(Event event, uint16_t arg) {
         return MISCHIEF_MANAGED;
     }
 
-    #ifdef USE_THERMAL_REGULATION
+    #if defined(USE_THERMAL_REGULATION) && defined(USE_THERM_MODEL)
+    // thermal model says how bright it can go without overheating
+    else if (event == EV_temperature_target) {
+        // (steps down gradually instead of using the hard limit)
+        therm_limit_level = 255;
+        uint8_t lvl = target_level;
+        if (arg < lvl) {
+            lvl = arg;
+            if (lvl < MIN_THERM_STEPDOWN) lvl = MIN_THERM_STEPDOWN;
+            if (lvl > target_level) lvl = target_level;
+        }
+        #ifdef USE_SET_LEVEL_GRADUALLY
+        set_level_gradually(lvl);
+        #else
+        set_level(lvl);
+        #endif
+        return MISCHIEF_MANAGED;
+    }
+    #elif defined(USE_THERMAL_REGULATION)
     // overheating: drop by an amount proportional to how far we are above the ceiling
     else if (event == EV_temperature_high) {
         #if 0
@@ -396,7 +448,7 @@ uint8_t steady_state(Event event, uint16_t arg) {
         return MISCHIEF_MANAGED;
     }
     #endif  // ifdef USE_SET_LEVEL_GRADUALLY
-    #endif  // ifdef USE_THERMAL_REGULATION
+    #endif  // ifdef USE_THERM_MODEL / USE_THERMAL_REGULATION
 
     ////////// Every action below here is blocked in the simple UI //////////
     // That is, unless we specifically want to enable 3C for smooth/stepped selection in Simple UI
@@ -650,10 +702,33 @@ uint8_t nearest_ramp_level(int16_t target) {
 }
 
 #ifdef USE_THERMAL_REGULATION
-void set_level_and_therm_target(uint8_t level) {
+// set the thermal target, and return the level to use right now
+static uint8_t set_therm_target(uint8_t level) {
     target_level = level;
-    set_level(level);
+    #ifdef USE_POWER_LIMIT
+    // don't go over the power limit, but go back up after it's lifted
+    power_limit_restore = 0;
+    if (level > power_limit_level) {
+        power_limit_restore = level;
+        level = power_limit_level;
+    }
+    #endif
+    return level;
+}
+
+void set_level_and_therm_target(uint8_t level) {
+    #ifdef USE_LVP_REGULATION
+    lvp_restore_level = 0;
+    #endif
+    set_level(set_therm_target(level));
 }
+
+#ifdef USE_LVP_REGULATION
+// like set_level_and_therm_target(), but gradual, and LVP can undo it later
+void lvp_set_therm_target(uint8_t level) {
+    set_level_gradually(set_therm_target(level));
+}
+#endif
 #else
 #define set_level_and_therm_target(level) set_level(level)
 #endif
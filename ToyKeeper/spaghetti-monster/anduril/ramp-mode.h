@@ -144,10 +144,33 @@ uint8_t nearest_ramp_level(int16_t target);
 // brightness before thermal step-down
 uint8_t target_level = 0;
 void set_level_and_therm_target(uint8_t level);
+#ifdef USE_POWER_LIMIT
+// level to go back to after the power limit is lifted (0 = none)
+uint8_t power_limit_restore = 0;
+#endif
 #else
 #define set_level_and_therm_target(level) set_level(level)
 #endif
 
+#ifdef USE_LVP_REGULATION
+#if !defined(USE_THERMAL_REGULATION) || !defined(USE_SET_LEVEL_GRADUALLY)
+#error USE_LVP_REGULATION requires USE_THERMAL_REGULATION and USE_SET_LEVEL_GRADUALLY
+#endif
+// level the user chose before LVP lowered the target (0 = none)
+uint8_t lvp_restore_level = 0;
+void lvp_set_therm_target(uint8_t level);
+// how far above VOLTAGE_LOW it must be to raise output again, volts * 10
+#ifndef LVP_REGULATION_MARGIN
+#define LVP_REGULATION_MARGIN 2
+#endif
+#endif
+
+#ifdef USE_POWER_LIMIT
+#if !defined(USE_THERMAL_REGULATION) || !defined(USE_SET_LEVEL_GRADUALLY)
+#error USE_POWER_LIMIT requires USE_THERMAL_REGULATION and USE_SET_LEVEL_GRADUALLY
+#endif
+#endif
+
 
 // brightness control
 #ifdef USE_MANUAL_MEMORY
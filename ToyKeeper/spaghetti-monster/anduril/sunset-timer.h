@@ -23,7 +23,11 @@
 // how many minutes to add each time the user "bumps" the timer?
 #define SUNSET_TIMER_UNIT 5
 
+#ifdef USE_WDT_CALIBRATION
+#define TICKS_PER_MINUTE wdt_ticks_per_minute
+#else
 #define TICKS_PER_MINUTE (TICKS_PER_SECOND*60)
+#endif
 
 // automatic shutoff timer
 uint8_t sunset_timer = 0;  // minutes remaining in countdown
@@ -44,8 +44,112 @@ uint8_t tempcheck_state(Event event, uint16_t arg) {
         push_state(thermal_config_state, 0);
         return MISCHIEF_MANAGED;
     }
+    #ifdef USE_THERM_AUTOTUNE
+    // start auto-tune, if it was requested in thermal config mode
+    else if (event == EV_reenter_state) {
+        if (thermal_autotune_rise) {
+            set_state(thermal_autotune_state, thermal_autotune_rise);
+            thermal_autotune_rise = 0;
+        }
+        return MISCHIEF_MANAGED;
+    }
+    #endif
+    return EVENT_NOT_HANDLED;
+}
+
+#ifdef USE_THERM_AUTOTUNE
+// measure a step response to tune the thermal model:
+// phase 0: turbo until the temperature rises by N C
+// phase 1: moon until it cools back down halfway
+// (fits the result as it goes, instead of recording every sample)
+uint8_t thermal_autotune_state(Event event, uint16_t arg) {
+    static uint8_t phase;
+    static uint8_t ticks;
+    static uint16_t seconds;
+    static uint16_t heat_seconds;
+    static int16_t start_temp;
+    static uint8_t rise;
+
+    if (event == EV_enter_state) {
+        phase = 0;
+        ticks = 0;
+        seconds = 0;
+        start_temp = temperature;
+        rise = arg;
+        // don't go past the safe limit
+        if (start_temp + rise > MAX_THERM_CEIL)
+            rise = MAX_THERM_CEIL - start_temp;
+        // too hot already?  try again after it cools off
+        // (bail out on the first tick, not while still entering the state)
+        if ((start_temp + 4 > MAX_THERM_CEIL) || (rise < 4)) {
+            rise = 0;
+            return MISCHIEF_MANAGED;
+        }
+        therm_limit_level = 255;
+        set_level(MAX_LEVEL);
+        return MISCHIEF_MANAGED;
+    }
+    // turn off on every way out, including aborts and timeouts
+    else if (event == EV_leave_state) {
+        set_level(0);
+        return MISCHIEF_MANAGED;
+    }
+    // 1 click: abort, without changing anything
+    else if (event == EV_1click) {
+        set_state(off_state, 0);
+        return MISCHIEF_MANAGED;
+    }
+    // the model is what's being tuned, so don't let it limit turbo
+    // (this mode has its own limit, MAX_THERM_CEIL)
+    else if (event == EV_temperature_target) {
+        therm_limit_level = 255;
+        return MISCHIEF_MANAGED;
+    }
+    else if (event == EV_tick) {
+        if (! rise) {
+            set_state(tempcheck_state, 0);
+            return MISCHIEF_MANAGED;
+        }
+        // only check once per second
+        if (++ticks < TICKS_PER_SECOND) return MISCHIEF_MANAGED;
+        ticks = 0;
+        seconds ++;
+
+        if (0 == phase) {  // heating
+            if (temperature >= start_temp + rise) {
+                heat_seconds = seconds;
+                seconds = 0;
+                phase = 1;
+                set_level(1);
+            }
+        }
+        else if (temperature <= start_temp + (rise >> 1)) {  // cooled
+            // half-life to time constant: tau = t / ln(2)
+            uint16_t tau = (seconds * 23) >> 4;
+            // steady-state rise at turbo, from the time it took to heat:
+            // N = rise * (1 - e^(-t/tau))
+            // ... so rise = N / (1 - e^(-t/tau)) ~= (N * tau / t) + (N / 2)
+            uint16_t r = ((uint32_t)rise * tau / heat_seconds) + (rise >> 1);
+            if (r > 127) r = 127;
+            therm_model_rise = r;
+            tau >>= 2;  // stored in 4-second units
+            if (tau > 255) tau = 255;
+            else if (tau < 1) tau = 1;
+            therm_model_tau = tau;
+            save_config();
+            blink_once();
+            set_state(tempcheck_state, 0);
+            return MISCHIEF_MANAGED;
+        }
+
+        // give up if it's taking way too long
+        if (seconds > THERM_AUTOTUNE_TIMEOUT)
+            set_state(tempcheck_state, 0);
+        return MISCHIEF_MANAGED;
+    }
     return EVENT_NOT_HANDLED;
 }
+#endif
 
 void thermal_config_save(uint8_t step, uint8_t value) {
     if (value) {
@@ -57,9 +161,16 @@ void thermal_config_save(uint8_t step, uint8_t value) {
         }
 
         // item 2: set maximum heat limit
-        else {
+        else if (step == 2) {
             therm_ceil = 30 + value - 1;
         }
+
+        #ifdef USE_THERM_AUTOTUNE
+        // item 3: auto-tune, heating up by N C
+        else {
+            thermal_autotune_rise = value;
+        }
+        #endif
     }
 
     if (therm_ceil > MAX_THERM_CEIL) therm_ceil = MAX_THERM_CEIL;
@@ -67,7 +178,12 @@ void thermal_config_save(uint8_t step, uint8_t value) {
 
 uint8_t thermal_config_state(Event event, uint16_t arg) {
     return config_state_base(event, arg,
-                             2, thermal_config_save);
+                             #ifdef USE_THERM_AUTOTUNE
+                             3,
+                             #else
+                             2,
+                             #endif
+                             thermal_config_save);
 }
 
 
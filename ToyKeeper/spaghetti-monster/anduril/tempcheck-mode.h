@@ -26,5 +26,19 @@ uint8_t tempcheck_state(Event event, uint16_t arg);
 uint8_t thermal_config_state(Event event, uint16_t arg);
 void thermal_config_save(uint8_t step, uint8_t value);
 
+#ifdef USE_THERM_AUTOTUNE
+#ifndef USE_THERM_MODEL
+#error USE_THERM_AUTOTUNE requires USE_THERM_MODEL
+#endif
+// measure how fast this light heats up and cools down
+uint8_t thermal_autotune_state(Event event, uint16_t arg);
+// how many C to heat up by, or 0 if no auto-tune was requested
+uint8_t thermal_autotune_rise = 0;
+// give up if either phase takes longer than this many seconds
+#ifndef THERM_AUTOTUNE_TIMEOUT
+#define THERM_AUTOTUNE_TIMEOUT (30*60)
+#endif
+#endif
+
 
 #endif
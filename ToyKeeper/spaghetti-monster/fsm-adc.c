@@ -20,12 +20,50 @@
 #ifndef FSM_ADC_C
 #define FSM_ADC_C
 
+#ifdef USE_SLEEP_LVP
+#include <avr/sleep.h>
+#include <util/delay_basic.h>
+#endif
+
 // override onboard temperature sensor definition, if relevant
 #ifdef USE_EXTERNAL_TEMP_SENSOR
 #ifdef ADMUX_THERM
 #undef ADMUX_THERM
 #endif
 #define ADMUX_THERM ADMUX_THERM_EXTERNAL_SENSOR
+
+// convert an external sensor reading (10-bit ADC units) to half degrees C,
+// with integer math only (no soft-float)
+static inline int16_t extern_temp_half_C(uint16_t m) {
+    #ifdef EXTERN_TEMP_NTC_TABLE
+    // piecewise-linear lookup, with ADC values falling as temperature rises
+    #define NTC_LEN (sizeof(extern_temp_ntc) / sizeof(uint16_t))
+    uint8_t i = 0;
+    uint16_t cold = pgm_read_word(extern_temp_ntc);
+    uint16_t hot = pgm_read_word(extern_temp_ntc + 1);
+    if (m > cold) m = cold;  // clamp to the coldest entry
+    while ((m < hot) && (i < NTC_LEN - 2)) {
+        i ++;
+        cold = hot;
+        hot = pgm_read_word(extern_temp_ntc + i + 1);
+    }
+    if (m < hot) m = hot;  // clamp to the hottest entry
+    #undef NTC_LEN
+    int16_t t = (EXTERN_TEMP_NTC_START + (i * EXTERN_TEMP_NTC_STEP)) << 1;
+    // (table is hand-edited, so don't divide by zero on a flat step)
+    if (cold > hot)
+        t += ((cold - m) * (EXTERN_TEMP_NTC_STEP << 1)) / (cold - hot);
+    return t;
+    #else
+    // linear sensor:
+    // C = (ADC - offset) * ref / 1024 / mV_per_C
+    // (scale is C per ADC unit, in 22.10 fixed point)
+    #define EXTERN_TEMP_OFFSET_ADC ((EXTERN_TEMP_OFFSET_MV*1024L + (EXTERN_TEMP_REF_MV/2)) / EXTERN_TEMP_REF_MV)
+    #define EXTERN_TEMP_SCALE ((EXTERN_TEMP_REF_MV*1000L + (EXTERN_TEMP_UV_PER_C/2)) / EXTERN_TEMP_UV_PER_C)
+    return ((int32_t)((int16_t)m - EXTERN_TEMP_OFFSET_ADC) * EXTERN_TEMP_SCALE
+            + (1<<8)) >> 9;
+    #endif
+}
 #endif
 
 
@@ -48,7 +86,8 @@ static inline void set_admux_therm() {
     ADC_start_measurement();
 }
 
-inline void set_admux_voltage() {
+// select the battery voltage input, without starting a conversion
+static inline void select_admux_voltage() {
     #if (ATTINY == 1634)
         #ifdef USE_VOLTAGE_DIVIDER // 1.1V / pin7
             ADMUX = ADMUX_VOLTAGE_DIVIDER;
@@ -81,6 +120,10 @@ inline void set_admux_voltage() {
     #else
         #error Unrecognized MCU type
     #endif
+}
+
+inline void set_admux_voltage() {
+    select_admux_voltage();
     adc_channel = 0;
     adc_sample_count = 0;  // first result is unstable
     ADC_start_measurement();
@@ -141,21 +184,264 @@ inline void ADC_off() {
     #endif
 }
 
+#ifdef USE_SLEEP_LVP
+// how long the 1.1V reference needs to stabilize after being switched on
+// (DS: bandgap start-up time is 40 us typical, 70 us max)
+#ifndef ADC_REF_SETTLE_US
+#define ADC_REF_SETTLE_US 70
+#endif
+// measure battery voltage once while asleep, and keep the ADC powered for
+// as short a time as possible
+// (leaving the free-running ADC on costs ~250 uA,
+//  and the usual standby level is only ~20 uA)
+void ADC_sleep_measurement() {
+    select_admux_voltage();
+    adc_channel = 0;
+    adc_deferred_enable = 1;
+    irq_adc = 0;
+
+    #if (ATTINY == 25) || (ATTINY == 45) || (ATTINY == 85) || (ATTINY == 841) || (ATTINY == 1634)
+        #if (ATTINY == 1634)
+        ADCSRB |= (1 << ADLAR);  // left-adjust flag is here instead of ADMUX
+        #endif
+        // enable, single conversion mode (no auto-retrigger), prescale
+        ADCSRA = (1 << ADEN) | (1 << ADIE) | ADC_PRSCL;
+        // wait for the reference to wake up
+        _delay_loop_2(BOGOMIPS * ADC_REF_SETTLE_US / 1000);
+        // first result after enabling the ADC is unstable
+        adc_sample_count = 0;
+        set_sleep_mode(SLEEP_MODE_ADC);
+    #elif defined(AVRXMEGA3)  // ATTINY816, 817, etc
+        VREF.CTRLA |= VREF_ADC0REFSEL_1V1_gc; // Set Vbg ref to 1.1V
+        // let the ADC hold off sampling until the reference is stable
+        // (16 ADC clocks at 10 MHz / 64 is ~100 us)
+        ADC0.CTRLD = ADC_INITDLY_DLY16_gc;
+        ADC0.CTRLA = ADC_ENABLE_bm | ADC_RUNSTBY_bm; // Enabled, single conversion
+        // initial delay already skips the unstable period
+        adc_sample_count = 1;
+        set_sleep_mode(SLEEP_MODE_STANDBY);
+    #else
+        #error Unrecognized MCU type
+    #endif
+
+    // sleep until the ISR has a usable result
+    // (and go back to sleep if something else woke us up first)
+    while (! irq_adc) {
+        ADC_start_measurement();
+        sleep_enable();
+        sleep_cpu();  // wait here
+        sleep_disable();
+    }
+
+    // power everything back down;
+    // the result gets handled by adc_deferred() from the standby loop
+    ADC_off();
+}
+#endif
+
 #ifdef USE_VOLTAGE_DIVIDER
-static inline uint8_t calc_voltage_divider(uint16_t value) {
-    // use 9.7 fixed-point to get sufficient precision
-    uint16_t adc_per_volt = ((ADC_44<<5) - (ADC_22<<5)) / (44-22);
+// use 9.7 fixed-point to get sufficient precision
+#define ADC_PER_VOLT (((ADC_44<<5) - (ADC_22<<5)) / (44-22))
+#endif
+
+#ifdef USE_VOLTAGE_LUT
+// build-time table to convert ADC values into voltage without dividing
+// (63 entries, one per 0.05V step above VOLTAGE_LUT_BASE)
+#ifdef USE_VOLTAGE_DIVIDER
+// lowest ADC value which means at least N * 0.05V
+#define VLUT_RAW(n) ((uint32_t)ADC_PER_VOLT * (VOLTAGE_LUT_BASE+1+(n)))
+#define VLUT(n) ((VLUT_RAW(n) > 0xffff) ? 0xffff : (uint16_t)VLUT_RAW(n))
+#else
+// highest ADC value (10-bit) which means at least N * 0.05V
+// ADC = 1.1 * 1024 / volts
+#define VLUT(n) ((uint16_t)(2*1.1*1024*10) / (VOLTAGE_LUT_BASE+1+(n)))
+#endif
+#define VLUT8(n) VLUT(n), VLUT(n+1), VLUT(n+2), VLUT(n+3), \
+                 VLUT(n+4), VLUT(n+5), VLUT(n+6), VLUT(n+7)
+PROGMEM const uint16_t voltage_lut[] = {
+    VLUT8(0), VLUT8(8), VLUT8(16), VLUT8(24),
+    VLUT8(32), VLUT8(40), VLUT8(48),
+    VLUT(56), VLUT(57), VLUT(58), VLUT(59), VLUT(60), VLUT(61), VLUT(62),
+};
+
+// returns volts * 20, clamped to the range covered by the table
+static inline uint8_t voltage_lut_lookup(uint16_t measurement) {
+    #ifndef USE_VOLTAGE_DIVIDER
+    uint16_t value = measurement >> 6;
+    #endif
+    // binary search for the number of steps the measurement reaches
+    uint8_t n = 0;
+    for (uint8_t step = 32; step; step >>= 1) {
+        uint16_t threshold = pgm_read_word(voltage_lut + n + step - 1);
+        #ifdef USE_VOLTAGE_DIVIDER
+        if (measurement >= threshold) n += step;
+        #else
+        if (value <= threshold) n += step;
+        #endif
+    }
+    return VOLTAGE_LUT_BASE + n;
+}
+#endif
+
+#ifdef USE_VOLTAGE_DIVIDER
+// returns volts * 20
+static inline uint16_t calc_voltage_divider(uint16_t value) {
     // shift incoming value into a matching position
-    uint8_t result = ((value / adc_per_volt)
+    #ifdef USE_VOLTAGE_LUT
+    uint16_t result = voltage_lut_lookup(value)
+    #else
+    uint16_t result = (value / ADC_PER_VOLT)
+    #endif
                      + VOLTAGE_FUDGE_FACTOR
-                     #ifdef USE_VOLTAGE_CORRECTION
+                     #if defined(USE_VOLTAGE_CORRECTION) && !defined(USE_VOLTAGE_CALIBRATION)
                      + voltage_correction - 7
                      #endif
-                     ) >> 1;
+                     ;
     return result;
 }
 #endif
 
+#ifdef USE_VOLTAGE_SAG_COMP
+// estimate how far the battery is sagging under the current load,
+// by comparing stable readings from before and after each level change
+// (v is the loaded voltage, in volts * 20)
+// returns the sag in volts * 20
+static inline uint8_t voltage_sag(uint16_t v) {
+    static uint8_t prev_level = 0;
+    static uint8_t settled = 0;
+    static uint8_t ref_load = 0;
+    static uint16_t ref_v = 0;
+    uint8_t load = LEVEL_LOAD(actual_level);
+
+    if (go_to_standby) {
+        // readings are too far apart while asleep, so start over after
+        ref_v = 0;
+    }
+    else if (actual_level != prev_level) {
+        // output changed, so wait for the voltage to settle
+        prev_level = actual_level;
+        settled = 0;
+    }
+    else {
+        if ((! settled) && ref_v) {
+            // compare against the last stable reading at the old level
+            int16_t dload = ref_load - load;
+            int16_t dv = v - ref_v;
+            if (dload < 0) { dload = -dload;  dv = -dv; }
+            // ignore small steps; the voltage resolution is too coarse
+            if ((dload >= VOLTAGE_SAG_MIN_STEP) && (dv >= 0)) {
+                uint16_t r = ((uint16_t)dv << 8) / dload;
+                if (r > 255) r = 255;
+                // lowpass the estimate, since each one is pretty noisy
+                voltage_sag_r = ((voltage_sag_r * 3) + r + 2) >> 2;
+            }
+        }
+        settled = 1;
+        ref_v = v;
+        ref_load = load;
+    }
+
+    return (voltage_sag_r * load) >> 8;
+}
+#endif
+
+#ifdef USE_VOLTAGE_CALIBRATION
+// recalculate the gain after either calibration point changes
+void voltage_cal_update() {
+    int16_t span = voltage_cal_v[1] - voltage_cal_v[0];
+    voltage_cal_gain = 0;
+    // (points too close together give a wildly wrong gain)
+    if (voltage_cal_v[0] && voltage_cal_v[1] && ((span > 3) || (span < -3))) {
+        // (in 32 bits, since the error difference * 256 overflows 16)
+        int32_t gain = ((int32_t)(voltage_cal_err[1] - voltage_cal_err[0]) << 8) / span;
+        // more than 1 step of error per step of voltage is a bad reading
+        if (gain > 256) gain = 256;
+        else if (gain < -256) gain = -256;
+        voltage_cal_gain = gain;
+    }
+}
+#endif
+
+#ifdef USE_SOC
+// resting li-ion state of charge (0 to 255) for 3.0V to 4.2V, per 0.1V
+PROGMEM const uint8_t soc_ocv[] = {
+    0, 3, 5, 10, 18, 26, 46, 102, 148, 184, 214, 240, 255,
+};
+#define SOC_OCV_BASE 30  // volts * 10 at the first entry
+#define SOC_OCV_LEN sizeof(soc_ocv)
+
+// subtract the charge used since the last call
+// (ticks: how many awake-sized ticks have passed since the last call)
+void soc_tick(uint8_t ticks) {
+    // charge used per second, as a fraction of capacity (2^32 = full)
+    #define SOC_PER_MAS (4294967296.0 / (SOC_CAPACITY_MAH * 3600.0))
+    #define SOC_PER_LOAD ((uint16_t)(SOC_CURRENT_AT_MAX_LEVEL * SOC_PER_MAS / LEVEL_LOAD(MAX_LEVEL)))
+    #define SOC_STANDBY ((uint16_t)(SOC_STANDBY_UA * SOC_PER_MAS / 1000))
+    // (these are floats until the cast, so #if can't check them)
+    _Static_assert(((SOC_CURRENT_AT_MAX_LEVEL * SOC_PER_MAS / LEVEL_LOAD(MAX_LEVEL)) >= 1)
+                   && ((SOC_CURRENT_AT_MAX_LEVEL * SOC_PER_MAS / LEVEL_LOAD(MAX_LEVEL)) < 65536),
+                   "SOC_CURRENT_AT_MAX_LEVEL / SOC_CAPACITY_MAH out of range");
+    _Static_assert((SOC_STANDBY_UA * SOC_PER_MAS / 1000) < 65536,
+                   "SOC_STANDBY_UA / SOC_CAPACITY_MAH out of range");
+    static uint16_t elapsed = 0;
+
+    // only update once per second
+    // (but catch up on several at once, after a long sleep tick)
+    elapsed += CAL_TICKS(ticks);
+    while (elapsed >= CAL_TICKS_PER_SECOND) {
+        elapsed -= CAL_TICKS_PER_SECOND;
+
+        uint32_t used = ((uint32_t)LEVEL_LOAD(actual_level) * SOC_PER_LOAD) + SOC_STANDBY;
+        if (used > soc_charge) soc_charge = 0;
+        else soc_charge -= used;
+
+        // track how long the battery has been resting
+        if (actual_level) soc_rest_seconds = 0;
+        else if (soc_rest_seconds < SOC_REST_SECONDS) soc_rest_seconds ++;
+    }
+}
+
+// nudge the state of charge toward what the resting voltage says
+static inline void soc_voltage_correction() {
+    #ifdef USE_TICKLESS_STANDBY
+    if (soc_untimed) {
+        soc_untimed = 0;
+        // no time was counted while asleep, so estimate it instead:
+        // if the voltage didn't recover while off, the cell had rested
+        // (if the light came on under load, it reads lower and waits)
+        if (voltage <= soc_sleep_voltage) soc_rest_seconds = SOC_REST_SECONDS;
+    }
+    #endif
+    if (soc_rest_seconds < SOC_REST_SECONDS) return;
+
+    int8_t i = voltage - SOC_OCV_BASE;
+    if (i < 0) i = 0;
+    else if (i >= (int8_t)SOC_OCV_LEN) i = SOC_OCV_LEN - 1;
+    uint8_t ocv = pgm_read_byte(soc_ocv + i);
+    uint8_t now = soc_level();
+
+    // no saved value, or way off (probably a different battery)
+    int16_t diff = ocv - now;
+    if ((! soc_known) || (diff > 64) || (diff < -64)) {
+        soc_charge = (uint32_t)ocv << 24;
+        soc_known = 1;
+    }
+    // otherwise, move slowly because voltage readings are coarse
+    else if (diff > 0) soc_charge += (1L << 20);
+    else if (diff < 0) soc_charge -= (1L << 20);
+}
+
+// equivalent resting voltage for the current state of charge, volts * 10
+uint8_t soc_to_voltage() {
+    uint8_t now = soc_level();
+    uint8_t i;
+    for (i = 0; (i < SOC_OCV_LEN - 1) && (pgm_read_byte(soc_ocv + i) < now); i ++) {}
+    // below the table, only the real voltage knows how empty it is
+    if ((! i) && (voltage < SOC_OCV_BASE)) return voltage;
+    return SOC_OCV_BASE + i;
+}
+#endif
+
 // Each full cycle runs ~2X per second with just voltage enabled,
 // or ~1X per second with voltage and temperature.
 #if defined(USE_LVP) && defined(USE_THERMAL_REGULATION)
@@ -182,19 +468,9 @@ ISR(ADC_vect) {
 
         // update the latest value
         #ifdef AVRXMEGA3  // ATTINY816, 817, etc
-        // Use the factory calibrated values in SIGROW.TEMPSENSE0 and SIGROW.TEMPSENSE1
-        // to calculate a temperature reading in Kelvin, then left-align it.
-        if (channel == 1) { // thermal, convert ADC reading to left-aligned Kelvin
-            int8_t sigrow_offset = SIGROW.TEMPSENSE1; // Read signed value from signature row
-            uint8_t sigrow_gain = SIGROW.TEMPSENSE0; // Read unsigned value from signature row
-            uint32_t temp = ADC0.RES - sigrow_offset;
-            temp *= sigrow_gain; // Result might overflow 16 bit variable (10bit+8bit)
-            temp += 0x80; // Add 1/2 to get correct rounding on division below
-            temp >>= 8; // Divide result to get Kelvin
-            m = (temp << 6); // left align it
-        }
-        else { m = (ADC0.RES << 6); } // voltage, force left-alignment
-
+        // force left-alignment
+        // (temperature calibration happens later, in adc_deferred())
+        m = (ADC0.RES << 6);
         #else
         m = ADC;
         #endif
@@ -255,9 +531,8 @@ void adc_deferred() {
     #endif
 
     #if defined(TICK_DURING_STANDBY) && defined(USE_SLEEP_LVP)
-        // in sleep mode, turn off after just one measurement
-        // (having the ADC on raises standby power by about 250 uA)
-        // (and the usual standby level is only ~20 uA)
+        // in sleep mode, make sure the ADC stays off after one measurement
+        // (ADC_sleep_measurement() normally takes care of this already)
         if (go_to_standby) {
             ADC_off();
             // also, only check the battery while asleep, not the temperature
@@ -346,18 +621,46 @@ static inline void ADC_voltage_handler() {
     //measurement = (measurement + 16) >> 5;
     measurement = (measurement + 16) & 0xffe0;  // 1111 1111 1110 0000
 
+    uint16_t v;  // volts * 20
     #ifdef USE_VOLTAGE_DIVIDER
-    voltage = calc_voltage_divider(measurement);
+    v = calc_voltage_divider(measurement);
     #else
     // calculate actual voltage: volts * 10
     // ADC = 1.1 * 1024 / volts
     // volts = 1.1 * 1024 / ADC
-    voltage = ((uint16_t)(2*1.1*1024*10)/(measurement>>6)
+    #ifdef USE_VOLTAGE_LUT
+    v = voltage_lut_lookup(measurement)
+    #else
+    v = (uint16_t)(2*1.1*1024*10)/(measurement>>6)
+    #endif
                + VOLTAGE_FUDGE_FACTOR
-               #ifdef USE_VOLTAGE_CORRECTION
+               #if defined(USE_VOLTAGE_CORRECTION) && !defined(USE_VOLTAGE_CALIBRATION)
                + voltage_correction - 7
                #endif
-               ) >> 1;
+               ;
+    #endif
+
+    #ifdef USE_VOLTAGE_CALIBRATION
+    voltage_uncal = v;
+    // two-point calibration, if set, replaces the simple offset
+    // (either point alone works as an offset; gain needs both)
+    uint8_t p = (voltage_cal_v[0]) ? 0 : 1;
+    if (voltage_cal_v[p])
+        v += voltage_cal_err[p]
+           + ((((int32_t)v - voltage_cal_v[p]) * voltage_cal_gain) >> 8);
+    else
+        v += voltage_correction - 7;
+    #endif
+
+    #ifdef USE_VOLTAGE_SAG_COMP
+    // report the estimated resting voltage, not the loaded voltage
+    voltage_loaded = v >> 1;
+    v += voltage_sag(v);
+    #endif
+    voltage = v >> 1;
+
+    #ifdef USE_SOC
+    soc_voltage_correction();
     #endif
 
     // if low, callback EV_voltage_low / EV_voltage_critical
@@ -368,7 +671,12 @@ static inline void ADC_voltage_handler() {
     	#ifdef DUAL_VOLTAGE_FLOOR
     	if (((voltage < VOLTAGE_LOW) && (voltage > DUAL_VOLTAGE_FLOOR)) || (voltage < DUAL_VOLTAGE_LOW_LOW)) {
     	#else
-        if (voltage < VOLTAGE_LOW) {
+        if ((voltage < VOLTAGE_LOW)
+            #ifdef USE_VOLTAGE_SAG_COMP
+            // don't let the battery sag too far under load either
+            || (voltage_loaded < VOLTAGE_LOW_LOADED)
+            #endif
+            ) {
         #endif
             // send out a warning
             emit(EV_voltage_low, 0);
@@ -402,24 +710,35 @@ static inline void ADC_temperature_handler() {
     // TODO? make this configurable per build target?
     //       (shorter time for hosts with a lower power-to-mass ratio)
     //       (because then it'll have smaller responses)
+    #ifdef USE_THERM_MULTIRATE
+    static uint8_t fast_step = 0;
+    static uint8_t slow_step = 0;
+    static uint8_t fast_ticks = 0;
+    static uint8_t slow_ticks = 0;
+    static uint16_t fast_history[THERM_FAST_STEPS];
+    static uint16_t slow_history[THERM_SLOW_STEPS];
+    #else
     #define NUM_TEMP_HISTORY_STEPS 8  // don't change; it'll break stuff
     static uint8_t history_step = 0;
     static uint16_t temperature_history[NUM_TEMP_HISTORY_STEPS];
+    #endif
     static int8_t warning_threshold = 0;
 
     if (adc_reset) {  // wipe out old data
         // ignore average, use latest sample
         adc_smooth[1] = adc_raw[1];
-
-        // forget any past measurements
-        uint16_t t = (adc_smooth[1] + 16) >> 5;
-        for(uint8_t i=0; i<NUM_TEMP_HISTORY_STEPS; i++)
-            temperature_history[i] = t;
     }
 
     // latest 16-bit ADC reading
     uint16_t measurement = adc_smooth[1];
 
+    #ifdef USE_TEMPSENSE_CAL
+    // apply the factory calibration to get left-aligned Kelvin
+    // (the 10-bit result might overflow 16 bits after the gain)
+    measurement = ((uint32_t)(measurement - (tempsense_offset << 6))
+                   * tempsense_gain + 0x80) >> 8;
+    #endif
+
     // values stair-step between intervals of 64, with random variations
     // of 1 or 2 in either direction, so if we chop off the last 6 bits
     // it'll flap between N and N-1...  but if we add half an interval,
@@ -430,27 +749,82 @@ static inline void ADC_temperature_handler() {
     measurement = (measurement + 16) >> 5;
     //measurement = (measurement + 16) & 0xffe0;  // 1111 1111 1110 0000
 
+    #ifdef USE_EXTERNAL_TEMP_SENSOR
+    // external sensor: convert to the same units as the onboard sensor,
+    // (C + 275) * 2, so the rest of the math works the same way
+    measurement = extern_temp_half_C(measurement>>1) + (275<<1);
+    #endif
+
+    if (adc_reset) {  // forget any past measurements
+        #ifdef USE_THERM_MULTIRATE
+        for(uint8_t i=0; i<THERM_FAST_STEPS; i++)
+            fast_history[i] = measurement;
+        for(uint8_t i=0; i<THERM_SLOW_STEPS; i++)
+            slow_history[i] = measurement;
+        #else
+        for(uint8_t i=0; i<NUM_TEMP_HISTORY_STEPS; i++)
+            temperature_history[i] = measurement;
+        #endif
+    }
+
     // let the UI see the current temperature in C
     // Convert ADC units to Celsius (ish)
-    #ifndef USE_EXTERNAL_TEMP_SENSOR
-    // onboard sensor for attiny25/45/85/1634
     temperature = (measurement>>1) + THERM_CAL_OFFSET + (int16_t)therm_cal_offset - 275;
-    #else
-    // external sensor
-    temperature = EXTERN_TEMP_FORMULA(measurement>>1) + THERM_CAL_OFFSET + (int16_t)therm_cal_offset;
+
+    #ifdef USE_THERM_MODEL
+    therm_model_update();
+    return;
     #endif
 
     // how much has the temperature changed between now and a few seconds ago?
     int16_t diff;
+    int16_t ahead;  // ... and how much will it change before the lookahead?
+    #ifdef USE_THERM_MULTIRATE
+    {
+        // scale both slopes to the change over 8 samples,
+        // so THERM_LOOKAHEAD means the same thing either way
+        // (with 3 extra bits, so a slow rise doesn't truncate to zero)
+        #define FAST_SPAN (THERM_FAST_STEPS * THERM_FAST_INTERVAL)
+        #define SLOW_SPAN (THERM_SLOW_STEPS * THERM_SLOW_INTERVAL)
+        int32_t fast = (int32_t)(int16_t)(measurement - fast_history[fast_step]) * 64 / FAST_SPAN;
+        int32_t slow = (int32_t)(int16_t)(measurement - slow_history[slow_step]) * 64 / SLOW_SPAN;
+        #undef FAST_SPAN
+        #undef SLOW_SPAN
+
+        // trust the fast slope more at high power, the slow one when
+        // heating is gradual and sensor noise would dominate
+        // (weights are in 1/8ths, so the blend is in 1/64ths, and the
+        //  extra bits only get dropped after the lookahead multiply)
+        uint8_t w = THERM_FAST_WEIGHT_LOW;
+        if (actual_level >= THERM_FAST_LEVEL) w = THERM_FAST_WEIGHT_HIGH;
+        int32_t d = fast * w + slow * (8 - w);
+        diff = (d + 32) >> 6;
+        ahead = (d * THERM_LOOKAHEAD + 32) >> 6;
+
+        // update / rotate each history at its own rate
+        if (++fast_ticks >= THERM_FAST_INTERVAL) {
+            fast_ticks = 0;
+            fast_history[fast_step] = measurement;
+            fast_step = (fast_step + 1) & (THERM_FAST_STEPS-1);
+        }
+        if (++slow_ticks >= THERM_SLOW_INTERVAL) {
+            slow_ticks = 0;
+            slow_history[slow_step] = measurement;
+            slow_step = (slow_step + 1) & (THERM_SLOW_STEPS-1);
+        }
+    }
+    #else
     diff = measurement - temperature_history[history_step];
+    ahead = diff * THERM_LOOKAHEAD;
 
     // update / rotate the temperature history
     temperature_history[history_step] = measurement;
     history_step = (history_step + 1) & (NUM_TEMP_HISTORY_STEPS-1);
+    #endif
 
     // PI[D]: guess what the temperature will be in a few seconds
     uint16_t pt;  // predicted temperature
-    pt = measurement + (diff * THERM_LOOKAHEAD);
+    pt = measurement + ahead;
 
     // convert temperature limit from C to raw 16-bit ADC units
     // C = (ADC>>6) - 275 + THERM_CAL_OFFSET + therm_cal_offset;
@@ -529,29 +903,82 @@ static inline void ADC_temperature_handler() {
 #endif
 
 
+#if defined(USE_THERMAL_REGULATION) && defined(USE_THERM_MODEL)
+// track how much heat the recent output should have produced,
+// and find the highest level which won't overshoot the ceiling
+static inline void therm_model_update() {
+    // modeled temperature rise above ambient, in C * 256
+    // (fine units, so small steps toward the target don't round to zero)
+    static int16_t rise = 0;
+    #define RISE_MAX ((int16_t)THERM_RISE << 8)
+    #define LOAD_MAX LEVEL_LOAD(MAX_LEVEL)
+
+    // don't know how long we were off, so assume it was long enough to
+    // cool down completely (this treats ambient as hotter, which is safe)
+    if (adc_reset) rise = 0;
+
+    // first-order model: approach the steady-state rise for this level
+    int16_t target = ((uint32_t)RISE_MAX * LEVEL_LOAD(actual_level)) / LOAD_MAX;
+    rise += (target - rise) / (int16_t)(THERM_TAU * ADC_CYCLES_PER_SECOND);
+
+    // ambient = temperature - rise, so if the highest allowed steady
+    // state is reached within the horizon, the temperature should just
+    // reach the ceiling:
+    //   allowed = rise + (ceil - temperature) / (1 - e^(-horizon/tau))
+    // ... with 1/(1-e^-x) approximated as 1/x + 1/2
+    // (gain is in 1/256 units, and tau can be up to ~1000 seconds)
+    #define THERM_MODEL_GAIN (128 + ((((uint16_t)THERM_TAU << 6) / THERM_MODEL_HORIZON) << 2))
+    int32_t allowed = rise + ((int32_t)THERM_MODEL_GAIN * (therm_ceil - temperature));
+
+    // find the highest level with a steady state below the allowed rise
+    uint8_t lvl = 0;
+    if (allowed > 0) {
+        if (allowed > RISE_MAX) allowed = RISE_MAX;
+        uint8_t load = ((uint32_t)LOAD_MAX * allowed) / RISE_MAX;
+        for (lvl = MAX_LEVEL;  lvl && (LEVEL_LOAD(lvl) > load);  lvl --) {}
+    }
+    #undef RISE_MAX
+    #undef LOAD_MAX
+
+    emit(EV_temperature_target, lvl);
+}
+#endif
+
+
 #ifdef USE_BATTCHECK
 #ifdef BATTCHECK_4bars
 PROGMEM const uint8_t voltage_blinks[] = {
-    30, 35, 38, 40, 42, 99,
+    VOLTAGE_STEP(30), VOLTAGE_STEP(35), VOLTAGE_STEP(38),
+    VOLTAGE_STEP(40), VOLTAGE_STEP(42), 99,
 };
 #endif
 #ifdef BATTCHECK_6bars
 PROGMEM const uint8_t voltage_blinks[] = {
-    30, 34, 36, 38, 40, 41, 43, 99,
+    VOLTAGE_STEP(30), VOLTAGE_STEP(34), VOLTAGE_STEP(36),
+    VOLTAGE_STEP(38), VOLTAGE_STEP(40), VOLTAGE_STEP(41),
+    VOLTAGE_STEP(43), 99,
 };
 #endif
 #ifdef BATTCHECK_8bars
 PROGMEM const uint8_t voltage_blinks[] = {
-    30, 33, 35, 37, 38, 39, 40, 41, 42, 99,
+    VOLTAGE_STEP(30), VOLTAGE_STEP(33), VOLTAGE_STEP(35),
+    VOLTAGE_STEP(37), VOLTAGE_STEP(38), VOLTAGE_STEP(39),
+    VOLTAGE_STEP(40), VOLTAGE_STEP(41), VOLTAGE_STEP(42), 99,
 };
 #endif
 void battcheck() {
+    #ifdef USE_SOC
+    // state of charge, as a resting voltage, is steadier than a reading
+    uint8_t volts = soc_to_voltage();
+    #else
+    uint8_t volts = voltage;
+    #endif
     #ifdef BATTCHECK_VpT
-    blink_num(voltage);
+    blink_num(volts);
     #else
     uint8_t i;
     for(i=0;
-        voltage >= pgm_read_byte(voltage_blinks + i);
+        volts >= pgm_read_byte(voltage_blinks + i);
         i++) {}
     #ifdef DONT_DELAY_AFTER_BATTCHECK
     blink_digit(i);
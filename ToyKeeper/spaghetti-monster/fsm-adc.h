@@ -36,6 +36,26 @@ volatile uint8_t adc_reset = 2;
 #ifndef VOLTAGE_LOW
 #define VOLTAGE_LOW 29
 #endif
+// convert voltage with a build-time lookup table instead of dividing
+// (enabled per light in its cfg file)
+//#define USE_VOLTAGE_LUT
+#ifdef USE_VOLTAGE_LUT
+#ifndef VOLTAGE_LUT_BASE
+#define VOLTAGE_LUT_BASE 32  // in 0.05V units (1.60V to 4.75V)
+#endif
+// range the table can report, in volts * 10
+#define VOLTAGE_LUT_MIN ((VOLTAGE_LUT_BASE + 1) / 2)
+#define VOLTAGE_LUT_MAX ((VOLTAGE_LUT_BASE + 63) / 2)
+#if (VOLTAGE_LOW < VOLTAGE_LUT_MIN) || (VOLTAGE_LOW > VOLTAGE_LUT_MAX)
+#error "VOLTAGE_LOW is outside the range of the voltage lookup table"
+#endif
+// clamp a voltage threshold to a value the table can actually report
+// (battcheck bars and aux colors use this, so every edge is reachable)
+#define VOLTAGE_STEP(v) (((v) < VOLTAGE_LUT_MIN) ? VOLTAGE_LUT_MIN : \
+                         ((v) > VOLTAGE_LUT_MAX) ? VOLTAGE_LUT_MAX : (v))
+#else
+#define VOLTAGE_STEP(v) (v)
+#endif
 // MCU sees voltage 0.X volts lower than actual, add X/2 to readings
 #ifndef VOLTAGE_FUDGE_FACTOR
 #ifdef USE_VOLTAGE_DIVIDER
@@ -55,6 +75,12 @@ uint16_t adc_smooth[2];  // lowpassed ADC measurements (0=voltage, 1=temperature
 // - deferred: the bulk of the logic runs later when time isn't so critical
 uint8_t adc_deferred_enable = 0;  // stop waiting and run the deferred code
 void adc_deferred();  // do the actual ADC-related calculations
+#if defined(AVRXMEGA3) && defined(USE_THERMAL_REGULATION) && !defined(USE_EXTERNAL_TEMP_SENSOR)
+// factory temperature calibration, copied from SIGROW at boot
+int8_t tempsense_offset;
+uint8_t tempsense_gain;
+#define USE_TEMPSENSE_CAL
+#endif
 
 static inline void ADC_voltage_handler();
 uint8_t voltage = 0;
@@ -62,7 +88,72 @@ uint8_t voltage = 0;
 // same 0.05V units as fudge factor,
 // but 7 is neutral, and the expected range is from 1 to 13
 uint8_t voltage_correction = 7;
+#ifdef USE_VOLTAGE_CALIBRATION
+// two-point calibration, in the same 0.05V units:
+// the measured voltage at each point (0 = not set), and its error
+// (either point alone gives an offset, both give offset and gain)
+uint8_t voltage_cal_v[2] = { 0, 0 };
+int8_t voltage_cal_err[2] = { 0, 0 };
+int16_t voltage_cal_gain = 0;  // change in error per 0.05V, * 256
+uint8_t voltage_uncal;  // latest reading before calibration, volts * 20
+void voltage_cal_update();
+#endif
+#endif
+#ifdef USE_VOLTAGE_SAG_COMP
+// estimate resting voltage by measuring internal resistance
+// (opt-in per hwdef, which should also define LEVEL_LOAD() from
+//  measured currents, since the default cubic curve is only a guess)
+// (voltage is the estimated resting voltage, volts * 10)
+uint8_t voltage_loaded = 0;  // actual voltage under load, volts * 10
+// estimated resistance, in (0.05V per LEVEL_LOAD unit) * 256
+// (LEVEL_LOAD is in fsm-ramping.h)
+uint8_t voltage_sag_r = 0;
+// smallest change in load which gives a useful estimate
+#ifndef VOLTAGE_SAG_MIN_STEP
+#define VOLTAGE_SAG_MIN_STEP 32
+#endif
+// LVP still triggers if the loaded voltage drops below this
+#ifndef VOLTAGE_LOW_LOADED
+#define VOLTAGE_LOW_LOADED (VOLTAGE_LOW - 4)
+#endif
 #endif
+#ifdef USE_SOC
+// state of charge, from counting current used at each level,
+// corrected by voltage readings after the battery has rested
+// (needs LEVEL_LOAD from fsm-ramping.h)
+// (aux LED colors and battcheck use it; LVP still uses the measured
+//  voltage, since LVP must protect the actual cell)
+#ifndef SOC_CAPACITY_MAH
+#define SOC_CAPACITY_MAH 3000
+#endif
+// estimated battery current at MAX_LEVEL, in mA
+#ifndef SOC_CURRENT_AT_MAX_LEVEL
+#define SOC_CURRENT_AT_MAX_LEVEL 6000
+#endif
+// average current while off, in uA
+#ifndef SOC_STANDBY_UA
+#define SOC_STANDBY_UA 30
+#endif
+// how long the light must be off before voltage is trusted, in seconds
+#ifndef SOC_REST_SECONDS
+#define SOC_REST_SECONDS (30*60)
+#endif
+// remaining charge, as a fraction of SOC_CAPACITY_MAH (0 to 2^32-1)
+uint32_t soc_charge = 0xffffffff;
+#define soc_level() ((uint8_t)(soc_charge >> 24))  // 0 to 255
+uint8_t soc_known = 0;  // set when soc_charge was loaded from EEPROM
+// assume the battery is rested at boot, since it was just connected
+uint16_t soc_rest_seconds = SOC_REST_SECONDS;
+#ifdef USE_TICKLESS_STANDBY
+// standby doesn't wake up just to count rest time, so after a sleep
+// with no ticks, the next reading decides whether the battery rested
+uint8_t soc_untimed = 0;
+uint8_t soc_sleep_voltage;  // last reading before the untimed sleep
+#endif
+void soc_tick(uint8_t ticks);
+uint8_t soc_to_voltage();
+#endif
+
 #ifdef USE_LVP
 void low_voltage();
 #endif
@@ -92,6 +183,93 @@ void battcheck();
 #ifndef THERM_CAL_OFFSET
 #define THERM_CAL_OFFSET 0
 #endif
+#ifdef USE_EXTERNAL_TEMP_SENSOR
+// external sensor parameters, from the hwdef file:
+// linear sensors (like MCP9700) use
+//   EXTERN_TEMP_REF_MV, EXTERN_TEMP_OFFSET_MV (at 0 C), EXTERN_TEMP_UV_PER_C
+// NTC thermistors use a table of 10-bit ADC values, one per
+//   EXTERN_TEMP_NTC_STEP C, starting at EXTERN_TEMP_NTC_START C
+//   (values must fall as temperature rises; flat steps don't interpolate)
+#ifdef EXTERN_TEMP_NTC_TABLE
+PROGMEM const uint16_t extern_temp_ntc[] = { EXTERN_TEMP_NTC_TABLE };
+#endif
+#endif
+#ifdef USE_THERM_MODEL
+// predict temperature from output level, and set a max level directly
+// instead of sending proportional high/low warnings
+// (emits EV_temperature_target, with the highest sustainable level)
+// steady-state temperature rise above ambient at MAX_LEVEL, in C (max 127)
+#ifndef THERM_MODEL_RISE
+#define THERM_MODEL_RISE 80
+#endif
+// thermal time constant (resistance * mass) in seconds
+#ifndef THERM_MODEL_TAU
+#define THERM_MODEL_TAU 120
+#endif
+// how far ahead to look, in seconds
+// (shorter allows more overshoot, longer is more conservative)
+#ifndef THERM_MODEL_HORIZON
+#define THERM_MODEL_HORIZON 30
+#endif
+#ifdef USE_THERM_AUTOTUNE
+// measured per light, by the thermal auto-tune mode
+uint8_t therm_model_rise = THERM_MODEL_RISE;
+uint8_t therm_model_tau = THERM_MODEL_TAU / 4;  // in 4-second units
+#define THERM_RISE therm_model_rise
+#define THERM_TAU ((uint16_t)therm_model_tau << 2)
+#else
+#define THERM_RISE THERM_MODEL_RISE
+#define THERM_TAU THERM_MODEL_TAU
+#endif
+static inline void therm_model_update();
+// highest level allowed in modes which don't handle EV_temperature_target
+// on their own (set by therm_target(), and enforced by set_level())
+uint8_t therm_limit_level = 255;
+void therm_target(uint8_t level);
+#endif
+#ifdef USE_THERM_MULTIRATE
+// estimate the temperature slope from two histories:
+// a short fast one for turbo spikes, and a long slow one for gradual
+// warm-up at lower levels, blended by the current output level
+// (steps must be a power of 2, intervals are in temperature samples)
+#ifndef THERM_FAST_STEPS
+#define THERM_FAST_STEPS 4
+#endif
+#ifndef THERM_FAST_INTERVAL
+#define THERM_FAST_INTERVAL 1
+#endif
+#ifndef THERM_SLOW_STEPS
+#define THERM_SLOW_STEPS 8
+#endif
+#ifndef THERM_SLOW_INTERVAL
+#define THERM_SLOW_INTERVAL 4
+#endif
+// weight of the fast slope, in 1/8ths, at or above / below THERM_FAST_LEVEL
+#ifndef THERM_FAST_LEVEL
+#define THERM_FAST_LEVEL (MAX_LEVEL*3/4)
+#endif
+#ifndef THERM_FAST_WEIGHT_HIGH
+#define THERM_FAST_WEIGHT_HIGH 6
+#endif
+#ifndef THERM_FAST_WEIGHT_LOW
+#define THERM_FAST_WEIGHT_LOW 1
+#endif
+// (history indexes wrap with a mask, not a modulo)
+#if (THERM_FAST_STEPS < 1) || (THERM_FAST_STEPS > 128) \
+    || (THERM_FAST_STEPS & (THERM_FAST_STEPS - 1))
+#error "THERM_FAST_STEPS must be a power of 2, from 1 to 128"
+#endif
+#if (THERM_SLOW_STEPS < 1) || (THERM_SLOW_STEPS > 128) \
+    || (THERM_SLOW_STEPS & (THERM_SLOW_STEPS - 1))
+#error "THERM_SLOW_STEPS must be a power of 2, from 1 to 128"
+#endif
+#if (THERM_FAST_INTERVAL < 1) || (THERM_SLOW_INTERVAL < 1)
+#error "THERM_FAST_INTERVAL and THERM_SLOW_INTERVAL must be at least 1"
+#endif
+#if (THERM_FAST_WEIGHT_HIGH > 8) || (THERM_FAST_WEIGHT_LOW > 8)
+#error "THERM_FAST_WEIGHT_HIGH and THERM_FAST_WEIGHT_LOW are in 1/8ths (0 to 8)"
+#endif
+#endif
 // temperature now, in C (ish)
 int16_t temperature;
 uint8_t therm_ceil = DEFAULT_THERM_CEIL;
@@ -21,6 +21,9 @@
 #define FSM_EVENTS_C
 
 #include <util/delay_basic.h>
+#ifdef USE_TIMER_DELAY
+#include <avr/sleep.h>
+#endif
 
 
 void append_emission(Event event, uint16_t arg) {
@@ -121,6 +124,82 @@ uint8_t push_event(uint8_t ev_type) {  // only for use by PCINT_inner()
 volatile uint8_t nice_delay_interrupt = 0;
 inline void interrupt_nice_delays() { nice_delay_interrupt = 1; }
 
+#ifdef USE_TIMER_DELAY
+// 1ms delay tick
+ISR(DELAY_TIMER_vect) {
+    DELAY_TIMER.INTFLAGS = TCB_CAPT_bm;  // clear the interrupt
+    irq_delay = 1;
+}
+
+// like delay_ms, except it aborts on state change
+// (and the MCU sleeps between delay ticks)
+// return value:
+//   0: state changed
+//   1: normal completion
+uint8_t nice_delay_ms(uint16_t ms) {
+    // (event handlers may start another delay inside this one)
+    static uint8_t depth = 0;
+    uint8_t result = 1;
+
+    // periodic interrupt every 1ms
+    if (! depth++) {
+        DELAY_TIMER.CNT = 0;
+        // (set the period before enabling, or the first tick comes early)
+        DELAY_TIMER.CCMP = (F_CPU / 1000) - 1;
+        DELAY_TIMER.CTRLB = TCB_CNTMODE_INT_gc;
+        DELAY_TIMER.INTFLAGS = TCB_CAPT_bm;
+        DELAY_TIMER.INTCTRL = TCB_CAPT_bm;
+        DELAY_TIMER.CTRLA = TCB_CLKSEL_CLKDIV1_gc | TCB_ENABLE_bm;
+        irq_delay = 0;
+    }
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while(ms-- > 0) {
+        if (nice_delay_interrupt) {
+            result = 0;
+            break;
+        }
+
+        #ifdef USE_DYNAMIC_UNDERCLOCKING
+        // the tick period assumes full speed, but set_level() may have
+        // slowed the clock (it's asleep most of the time anyway)
+        clock_prescale_set(clock_div_1);
+        #endif
+
+        // sleep until the next delay tick
+        // (other interrupts wake it up too, so keep going back to sleep)
+        // (sei right before sleep is atomic, so the tick can't be missed)
+        cli();
+        // the free-running ADC would wake it after every conversion,
+        // so only take its latest result once per tick instead
+        uint8_t adc_int = ADC0.INTCTRL;
+        ADC0.INTCTRL = 0;
+        while (! irq_delay) {
+            sleep_enable();
+            sei();
+            sleep_cpu();
+            sleep_disable();
+            cli();
+        }
+        irq_delay = 0;
+        ADC0.INTCTRL = adc_int;  // (a pending result fires right away)
+        sei();
+
+        // run pending system processes while we wait
+        handle_deferred_interrupts();
+
+        // handle events only afterward (see below)
+        process_emissions();
+    }
+
+    // stop the timer, it's not needed until the next delay
+    if (! --depth) {
+        DELAY_TIMER.CTRLA = 0;
+        DELAY_TIMER.INTCTRL = 0;
+    }
+    return result;
+}
+#else
 // like delay_ms, except it aborts on state change
 // return value:
 //   0: state changed
@@ -180,6 +259,7 @@ uint8_t nice_delay_ms(uint16_t ms) {
     }
     return 1;
 }
+#endif  // ifdef USE_TIMER_DELAY
 
 #ifdef USE_DYNAMIC_UNDERCLOCKING
 void delay_4ms(uint8_t ms) {
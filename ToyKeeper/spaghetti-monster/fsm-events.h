@@ -72,6 +72,20 @@ uint8_t push_event(uint8_t ev_type);  // only for use by PCINT_inner()
 // ... this probably isn't the right place for delays.
 inline void interrupt_nice_delays();
 uint8_t nice_delay_ms(uint16_t ms);
+#ifdef USE_TIMER_DELAY
+#ifndef AVRXMEGA3
+#error "USE_TIMER_DELAY requires an attiny 1-series MCU"
+#endif
+// sleep in nice_delay_ms() instead of spinning, using 1ms interrupts
+// from a spare TCB timer (the hwdef may pick a different one)
+// (the ADC interrupt is held off while it sleeps, so the free-running
+//  ADC only gets read once per delay tick)
+#ifndef DELAY_TIMER
+#define DELAY_TIMER TCB0
+#define DELAY_TIMER_vect TCB0_INT_vect
+#endif
+volatile uint8_t irq_delay = 0;  // delay timer interrupt happened?
+#endif
 //uint8_t nice_delay_s();
 void delay_4ms(uint8_t ms);
 
@@ -116,6 +130,9 @@ void delay_4ms(uint8_t ms);
 #define EV_temperature_high    (B_SYSTEM|0b00000101)
 #define EV_temperature_low     (B_SYSTEM|0b00000110)
 #define EV_temperature_okay    (B_SYSTEM|0b00000111)
+#ifdef USE_THERM_MODEL
+#define EV_temperature_target  (B_SYSTEM|0b00001011)
+#endif
 #endif
 
 // Button press events
@@ -95,6 +95,83 @@ static inline void hw_setup() {
 #endif
 
 
+#ifdef USE_POWER_GATING
+// turn off peripherals which nothing in the FSM or UI uses, at boot
+// (the PWM timers are handled per state, by power_gate_apply())
+// (the ADC is handled by ADC_on() / ADC_off())
+static inline void power_gate_unused() {
+    #ifdef AVRXMEGA3  // ATTINY816, 817, etc
+        // everything is already off unless enabled, except maybe the BOD,
+        // which can stay on in sleep depending on fuses
+        _PROTECTED_WRITE(BOD.CTRLA, (BOD.CTRLA & ~BOD_SLEEP_gm) | BOD_SLEEP_DIS_gc);
+    #else
+        #ifdef power_usi_disable
+        power_usi_disable();
+        #endif
+        #ifdef power_twi_disable
+        power_twi_disable();
+        #endif
+        #ifdef power_spi_disable
+        power_spi_disable();
+        #endif
+        #ifdef power_usart0_disable
+        power_usart0_disable();
+        #endif
+        #ifdef power_usart1_disable
+        power_usart1_disable();
+        #endif
+        // analog comparator
+        #if defined(ACSRA)
+        ACSRA |= (1 << ACD);
+        #elif defined(ACSR)
+        ACSR |= (1 << ACD);
+        #endif
+        // (BOD in sleep is turned off each time, before sleeping)
+    #endif
+}
+
+// stop the PWM timers while nothing needs them, like at level 0
+// (only once the counter is past BOTTOM, since fast PWM pulses high
+//  there even at 0, and a stopped timer leaves its pins as they were)
+void power_gate_apply() {
+    // (states' needs don't count in standby)
+    uint8_t pwm = actual_level
+               || ((power_needs & POWER_PWM) && (! go_to_standby));
+    #ifdef AVRXMEGA3  // ATTINY816, 817, etc
+        if (pwm) TCA0.SINGLE.CTRLA |= TCA_SINGLE_ENABLE_bm;
+        else if (TCA0.SINGLE.CTRLA & TCA_SINGLE_ENABLE_bm) {
+            while (TCA0.SINGLE.CNT < 2) {}
+            TCA0.SINGLE.CTRLA &= ~TCA_SINGLE_ENABLE_bm;
+        }
+    #else
+        #if (ATTINY == 1634)
+        #define PWM_TIMER1_RUNNING (TCCR1B & 0x07)
+        #else
+        #define PWM_TIMER1_RUNNING (TCCR1 & 0x0f)
+        #endif
+        if (pwm) {
+            power_timer0_enable();
+            power_timer1_enable();
+            return;
+        }
+        // (timer0 runs the aux PWM, which stops it when it's not in use)
+        #ifndef USE_AUX_PWM
+        if (! (PRR & (1 << PRTIM0))) {
+            if (TCCR0B & 0x07) while (TCNT0 < 2) {}
+            power_timer0_disable();
+        }
+        #endif
+        // (the 4th PWM channel needs timer1 interrupts)
+        #if PWM_CHANNELS < 4
+        if (! (PRR & (1 << PRTIM1))) {
+            if (PWM_TIMER1_RUNNING) while (TCNT1 < 2) {}
+            power_timer1_disable();
+        }
+        #endif
+    #endif
+}
+#endif
+
 //#ifdef USE_REBOOT
 static inline void prevent_reboot_loop() {
     // prevent WDT from rebooting MCU again
@@ -120,6 +197,16 @@ int main() {
 
     hw_setup();
 
+    #ifdef USE_POWER_GATING
+    power_gate_unused();
+    #endif
+
+    #ifdef USE_TEMPSENSE_CAL
+    // these never change, so read them only once
+    tempsense_offset = SIGROW.TEMPSENSE1;  // signed
+    tempsense_gain = SIGROW.TEMPSENSE0;  // unsigned
+    #endif
+
     #if 0
     #ifdef HALFSPEED
     // run at half speed
@@ -135,7 +222,14 @@ int main() {
 
     // all booted -- turn interrupts back on
     PCINT_on();
+    #if defined(USE_RTC_CRYSTAL) || defined(USE_RTC_WAKEUP)
+    RTC_on();
+    #endif
     WDT_on();
+    #ifdef USE_WDT_CALIBRATION
+    // measure the tick length before anything else uses the timer
+    wdt_calibrate();
+    #endif
     ADC_on();
     sei();
 
@@ -24,4 +24,21 @@ int main();
 // needs to run frequently to execute the logic for WDT and ADC and stuff
 void handle_deferred_interrupts();
 
+#ifdef USE_POWER_GATING
+#ifndef USE_RAMPING
+#error "USE_POWER_GATING requires USE_RAMPING"
+#endif
+// peripherals a state needs while awake, beyond what its output level
+// needs (set_state() clears this before EV_enter_state, so each state
+// declares its own with power_need())
+// keep the PWM timers running even at level 0
+// (for states which write PWM registers directly, instead of set_level())
+#define POWER_PWM 1
+uint8_t power_needs = 0;
+#define power_need(x) (power_needs |= (x))
+// turn peripherals on or off, for the current state and level
+// (called on state changes, on level changes, and before standby)
+void power_gate_apply();
+#endif
+
 #endif
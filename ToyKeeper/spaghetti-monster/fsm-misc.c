@@ -179,9 +179,133 @@ void indicator_led_auto() {
 */
 #endif  // USE_INDICATOR_LED
 
+#ifdef USE_AUX_RGB_LEDS
+// aux LED pins, in R, G, B order
+PROGMEM const uint8_t aux_rgb_pins[] = {
+    AUXLED_R_PIN, AUXLED_G_PIN, AUXLED_B_PIN,
+};
+#endif
+
+#ifdef USE_AUX_PWM
+// software PWM, with timer0 in normal mode at clk/64 (~488 Hz at 8 MHz)
+// pins go on at overflow, then off at OCR0A matches, with the match moved
+// up to the next level each time, so it only interrupts once per cycle
+// for each different level, instead of once per step
+static void aux_pwm_edge(uint8_t now) {
+    uint8_t next = AUX_PWM_MAX;
+    uint8_t off = 0;
+    for (uint8_t i=0; i<3; i++) {
+        uint8_t lvl = aux_pwm_lvl[i];
+        if (lvl <= now) off |= (1 << pgm_read_byte(aux_rgb_pins + i));
+        else if (lvl < next) next = lvl;
+    }
+    AUXLED_RGB_PORT &= 0xff ^ (off & aux_pwm_rgb_mask);
+    #ifdef USE_BUTTON_LED
+    uint8_t lvl = aux_pwm_lvl[AUX_PWM_BUTTON];
+    if (lvl <= now) BUTTON_LED_PORT &= 0xff ^ aux_pwm_button_mask;
+    else if (lvl < next) next = lvl;
+    #endif
+    // (if nothing's left, the old match already passed, so leave it)
+    if (next < AUX_PWM_MAX) OCR0A = next << 4;
+}
+
+ISR(TIMER0_OVF_vect) {
+    AUXLED_RGB_PORT |= aux_pwm_rgb_mask;
+    #ifdef USE_BUTTON_LED
+    BUTTON_LED_PORT |= aux_pwm_button_mask;
+    #endif
+    aux_pwm_edge(0);
+}
+
+ISR(TIMER0_COMPA_vect) {
+    aux_pwm_edge(OCR0A >> 4);
+}
+
+// configure one aux pin for its brightness level
+static void aux_pwm_apply(uint8_t channel) {
+    uint8_t lvl = aux_pwm_lvl[channel];
+    // 0=off, 1=pull-up, 2=high, 3=PWM
+    uint8_t mode = 3;
+    if (! lvl) mode = 0;
+    else if (lvl >= AUX_PWM_MAX) mode = 2;
+    else if (aux_pwm_asleep) mode = 1;
+
+    #ifdef USE_BUTTON_LED
+    if (AUX_PWM_BUTTON == channel) {
+        uint8_t bit = (1 << BUTTON_LED_PIN);
+        aux_pwm_button_mask = (3 == mode) ? bit : 0;
+        BUTTON_LED_PUE &= 0xff ^ bit;
+        if (1 == mode) {
+            BUTTON_LED_DDR &= 0xff ^ bit;
+            BUTTON_LED_PUE |= bit;
+            BUTTON_LED_PORT |= bit;
+        } else {
+            BUTTON_LED_DDR |= bit;
+            if (2 == mode) BUTTON_LED_PORT |= bit;
+            else BUTTON_LED_PORT &= 0xff ^ bit;
+        }
+    }
+    else
+    #endif
+    {
+        uint8_t bit = (1 << pgm_read_byte(aux_rgb_pins + channel));
+        uint8_t mask = aux_pwm_rgb_mask & (0xff ^ bit);
+        if (3 == mode) mask |= bit;
+        aux_pwm_rgb_mask = mask;
+        AUXLED_RGB_PUE &= 0xff ^ bit;
+        if (1 == mode) {
+            AUXLED_RGB_DDR &= 0xff ^ bit;
+            AUXLED_RGB_PUE |= bit;
+            AUXLED_RGB_PORT |= bit;
+        } else {
+            AUXLED_RGB_DDR |= bit;
+            if (2 == mode) AUXLED_RGB_PORT |= bit;
+            else AUXLED_RGB_PORT &= 0xff ^ bit;
+        }
+    }
+
+    // only run the timer while something needs it
+    uint8_t need_timer = aux_pwm_rgb_mask
+        #ifdef USE_BUTTON_LED
+        | aux_pwm_button_mask
+        #endif
+        ;
+    if (need_timer) {
+        TCCR0A = 0;  // normal mode
+        TCCR0B = (1 << CS01) | (1 << CS00);  // clk/64
+        TIMSK |= (1 << TOIE0) | (1 << OCIE0A);
+    } else {
+        TCCR0B = 0;  // stopped
+        TIMSK &= 0xff ^ ((1 << TOIE0) | (1 << OCIE0A));
+    }
+}
+
+void aux_pwm_set(uint8_t channel, uint8_t lvl) {
+    if (lvl > AUX_PWM_MAX) lvl = AUX_PWM_MAX;
+    aux_pwm_lvl[channel] = lvl;
+    aux_pwm_apply(channel);
+}
+
+// switch dim levels between PWM (awake) and pull-up (standby)
+void aux_pwm_sleep(uint8_t asleep) {
+    aux_pwm_asleep = asleep;
+    for (uint8_t i=0; i<AUX_PWM_CHANNELS; i++) aux_pwm_apply(i);
+}
+
+// convert an off / low / high level to PWM brightness
+static uint8_t aux_pwm_from_lvl(uint8_t lvl) {
+    if (! lvl) return 0;
+    if (1 == lvl) return AUX_PWM_LOW;
+    return AUX_PWM_MAX;
+}
+#endif  // ifdef USE_AUX_PWM
+
 #ifdef USE_BUTTON_LED
 // TODO: Refactor this and RGB LED function to merge code and save space
 void button_led_set(uint8_t lvl) {
+    #ifdef USE_AUX_PWM
+    aux_pwm_set(AUX_PWM_BUTTON, aux_pwm_from_lvl(lvl));
+    #else
     switch (lvl) {
 
         #ifdef AVRXMEGA3  // ATTINY816, 817, etc
@@ -220,16 +344,20 @@ void button_led_set(uint8_t lvl) {
 
         #endif  // MCU type
     }
+    #endif  // ifdef USE_AUX_PWM
 }
 #endif
 
 #ifdef USE_AUX_RGB_LEDS
 void rgb_led_set(uint8_t value) {
     // value: 0b00BBGGRR
-    uint8_t pins[] = { AUXLED_R_PIN, AUXLED_G_PIN, AUXLED_B_PIN };
+    #ifdef USE_AUX_PWM
+    for (uint8_t i=0; i<3; i++)
+        aux_pwm_set(i, aux_pwm_from_lvl((value >> (i<<1)) & 0x03));
+    #else
     for (uint8_t i=0; i<3; i++) {
         uint8_t lvl = (value >> (i<<1)) & 0x03;
-        uint8_t pin = pins[i];
+        uint8_t pin = pgm_read_byte(aux_rgb_pins + i);
         switch (lvl) {
         
             #ifdef AVRXMEGA3  // ATTINY816, 817, etc
@@ -269,6 +397,7 @@ void rgb_led_set(uint8_t value) {
             #endif  // MCU type                    
         }
     }
+    #endif  // ifdef USE_AUX_PWM
 }
 #endif  // ifdef USE_AUX_RGB_LEDS
 
@@ -59,6 +59,42 @@ void button_led_set(uint8_t lvl);
 void rgb_led_set(uint8_t value);
 #endif
 
+#ifdef USE_AUX_PWM
+// finer brightness for the aux LEDs, instead of just off / pull-up / high
+// (uses timer0, so don't use it on hwdefs which drive main LEDs with it)
+// (not measured on hardware yet, so no light enables it by default)
+#if (ATTINY != 1634) || !defined(USE_AUX_RGB_LEDS)
+#error "USE_AUX_PWM needs aux RGB LEDs on an attiny1634"
+#endif
+// brightness per channel: 0 = off, 1 to 14 = PWM, 15 = solid on
+#define AUX_PWM_MAX 15
+// what "low" means for rgb_led_set() and button_led_set()
+#ifndef AUX_PWM_LOW
+#define AUX_PWM_LOW 1
+#endif
+// channels
+#define AUX_PWM_R 0
+#define AUX_PWM_G 1
+#define AUX_PWM_B 2
+#ifdef USE_BUTTON_LED
+#define AUX_PWM_BUTTON 3
+#define AUX_PWM_CHANNELS 4
+#else
+#define AUX_PWM_CHANNELS 3
+#endif
+uint8_t aux_pwm_lvl[AUX_PWM_CHANNELS];
+// PWM pins, as bitmasks on their ports
+uint8_t aux_pwm_rgb_mask = 0;
+#ifdef USE_BUTTON_LED
+uint8_t aux_pwm_button_mask = 0;
+#endif
+// timer0 stops in standby, so use the pull-up trick for dim levels then
+uint8_t aux_pwm_asleep = 0;
+void aux_pwm_set(uint8_t channel, uint8_t lvl);
+// call before and after standby
+void aux_pwm_sleep(uint8_t asleep);
+#endif
+
 #ifdef USE_TRIANGLE_WAVE
 uint8_t triangle_wave(uint8_t phase);
 #endif
@@ -36,8 +36,24 @@ void set_level(uint8_t level) {
     }
     #endif  // ifdef USE_JUMP_START
 
+    #ifdef USE_POWER_LIMIT
+    // cap every mode, not just the ones which step down on their own
+    if (level > power_limit_level) level = power_limit_level;
+    #endif
+
+    #if defined(USE_THERMAL_REGULATION) && defined(USE_THERM_MODEL)
+    // same for heat, in modes which don't regulate it themselves
+    if (level > therm_limit_level) level = therm_limit_level;
+    #endif
+
     actual_level = level;
 
+    #ifdef USE_POWER_GATING
+    // make sure the PWM timers are on before using them
+    // (or turn them off, for level 0, after the outputs are set below)
+    if (actual_level) power_gate_apply();
+    #endif
+
     #ifdef USE_SET_LEVEL_GRADUALLY
     gradual_target = level;
     #endif
@@ -107,17 +123,24 @@ void set_level(uint8_t level) {
         #if defined(PWM3_CNT) && defined(PWM3_PHASE_RESET_OFF)
             PWM3_CNT = 0;
         #endif
+        #ifdef USE_LED_KEEP_WARM
+        // pins which are quick to turn on can go off now
+        #if defined(LED_ENABLE_PIN) && !defined(LED_ON_DELAY)
+        LED_ENABLE_PORT &= ~(1 << LED_ENABLE_PIN);
+        #endif
+        #if defined(LED2_ENABLE_PIN) && !defined(LED2_ON_DELAY)
+        LED2_ENABLE_PORT &= ~(1 << LED2_ENABLE_PIN);
+        #endif
+        // leave the slow ones on for a bit, in case they're needed again
+        // (led_warm_tick() turns them off later)
+        led_warm_ticks = LED_KEEP_WARM_TICKS;
+        #else
         #ifdef LED_OFF_DELAY
             // for drivers with a slow regulator chip (eg, boost converter),
             // delay before turning off to prevent flashes
             delay_4ms(LED_OFF_DELAY/4);
         #endif
-        // disable the power channel, if relevant
-        #ifdef LED_ENABLE_PIN
-        LED_ENABLE_PORT &= ~(1 << LED_ENABLE_PIN);
-        #endif
-        #ifdef LED2_ENABLE_PIN
-        LED2_ENABLE_PORT &= ~(1 << LED2_ENABLE_PIN);
+        led_enable_off();
         #endif
     } else {
         // enable the power channel, if relevant
@@ -231,13 +254,108 @@ void set_level(uint8_t level) {
     prev_level = api_level;
     #endif
     #endif  // ifdef OVERRIDE_SET_LEVEL
+    #ifdef USE_POWER_GATING
+    if (! actual_level) power_gate_apply();
+    #endif
     #ifdef USE_DYNAMIC_UNDERCLOCKING
     auto_clock_speed();
     #endif
 }
 
+#ifdef USE_POWER_LIMIT
+// track how much energy was used recently, and set a limit when it's
+// more than the host can handle
+// (ticks: how many awake-sized ticks have passed since the last call)
+#define LEVEL_POWER(lvl) (((uint32_t)POWER_AT_MAX_LEVEL * LEVEL_LOAD(lvl)) / LEVEL_LOAD(MAX_LEVEL))
+void power_limit_tick(uint8_t ticks) {
+    #define BUDGET_MAX (POWER_BURST_JOULES * 10)
+    static uint16_t elapsed = 0;
+    static int16_t budget = BUDGET_MAX;  // in joules * 10
+
+    // only update once per second
+    // (but catch up on several at once, after a long sleep tick)
+    elapsed += CAL_TICKS(ticks);
+    if (elapsed < CAL_TICKS_PER_SECOND) return;
+
+    // leaky bucket: refill at the sustained rate, drain at the current rate
+    int16_t delta = POWER_SUSTAINED - (int16_t)LEVEL_POWER(actual_level);
+    do {
+        elapsed -= CAL_TICKS_PER_SECOND;
+        budget += delta;
+        if (budget > BUDGET_MAX) budget = BUDGET_MAX;
+        else if (budget < 0) budget = 0;
+    } while (elapsed >= CAL_TICKS_PER_SECOND);
+
+    if (! budget) {
+        // out of budget; only allow what the host can sustain
+        // (this never changes, so only search for it once)
+        static uint8_t sustained_level = 0;
+        if (! sustained_level) {
+            uint8_t lvl;
+            for (lvl = MAX_LEVEL;
+                 (lvl > 1) && (LEVEL_POWER(lvl) > POWER_SUSTAINED);
+                 lvl --) {}
+            sustained_level = lvl;
+        }
+        power_limit_level = sustained_level;
+    }
+    // wait for some of the budget to come back before lifting the limit
+    else if (budget > (BUDGET_MAX / 4)) {
+        power_limit_level = 255;
+    }
+    #undef BUDGET_MAX
+}
+#endif
+
+// disable the power channel, if relevant
+void led_enable_off() {
+    #ifdef LED_ENABLE_PIN
+    LED_ENABLE_PORT &= ~(1 << LED_ENABLE_PIN);
+    #endif
+    #ifdef LED2_ENABLE_PIN
+    LED2_ENABLE_PORT &= ~(1 << LED2_ENABLE_PIN);
+    #endif
+}
+
+#ifdef USE_LED_KEEP_WARM
+// count down the keep-warm window, and power down once it runs out
+// (ticks: how many awake-sized ticks passed)
+void led_warm_tick(uint16_t ticks) {
+    if (actual_level || (! led_warm_ticks)) return;
+    if (ticks < led_warm_ticks) led_warm_ticks -= ticks;
+    else {
+        led_warm_ticks = 0;
+        led_enable_off();
+    }
+}
+#endif
+
+#ifdef USE_LED_PREWARM
+// get the regulator ready before the light actually turns on,
+// so the next set_level() doesn't have to wait for it
+// (if nothing uses it, the keep-warm window turns it back off)
+void led_prewarm(uint8_t level) {
+    if (actual_level) return;  // already on
+    // only the slow pins need a head start
+    #if defined(LED_ENABLE_PIN) && defined(LED_ON_DELAY)
+        #ifdef LED_ENABLE_PIN_LEVEL_MIN
+        if ((level >= LED_ENABLE_PIN_LEVEL_MIN)
+                && (level <= LED_ENABLE_PIN_LEVEL_MAX))
+        #endif
+        LED_ENABLE_PORT |= (1 << LED_ENABLE_PIN);
+    #endif
+    #if defined(LED2_ENABLE_PIN) && defined(LED2_ON_DELAY)
+    LED2_ENABLE_PORT |= (1 << LED2_ENABLE_PIN);
+    #endif
+    led_warm_ticks = LED_KEEP_WARM_TICKS;
+}
+#endif
+
 #ifdef USE_SET_LEVEL_GRADUALLY
 inline void set_level_gradually(uint8_t lvl) {
+    #ifdef USE_POWER_LIMIT
+    if (lvl > power_limit_level) lvl = power_limit_level;
+    #endif
     gradual_target = lvl;
 }
 
@@ -40,6 +40,47 @@ void update_tint();
 #define USE_TRIANGLE_WAVE
 #endif
 
+#if defined(USE_VOLTAGE_SAG_COMP) || defined(USE_THERM_MODEL) \
+    || defined(USE_POWER_LIMIT) || defined(USE_SOC)
+// rough relative battery current at each level, 0 to ~200
+// (override in hwdef if the ramp isn't roughly cubic)
+#ifndef LEVEL_LOAD
+#define LEVEL_LOAD(lvl) ((uint8_t)(((((uint16_t)(lvl)*(lvl))>>7) * (lvl)) >> 7))
+#endif
+#endif
+
+// turn off the regulator / opamp enable pins, if any
+void led_enable_off();
+
+#ifdef USE_LED_PREWARM
+// the keep-warm window rolls back a pre-warm which didn't get used
+#define USE_LED_KEEP_WARM
+#endif
+// keep-warm only matters for enable pins with a slow start-up
+// (other enable pins, like range selects, still turn off right away)
+#if defined(USE_LED_KEEP_WARM) \
+    && !((defined(LED_ENABLE_PIN) && defined(LED_ON_DELAY)) \
+      || (defined(LED2_ENABLE_PIN) && defined(LED2_ON_DELAY)))
+#undef USE_LED_KEEP_WARM
+#endif
+#ifdef USE_LED_KEEP_WARM
+// leave the regulator / opamp powered for a moment after going to level 0,
+// so turning right back on doesn't have to wait for LED_ON_DELAY
+// (or LED2_ON_DELAY)
+#ifndef LED_KEEP_WARM_TICKS
+#define LED_KEEP_WARM_TICKS (TICKS_PER_SECOND/2)
+#endif
+// ticks left before the enable pins turn off
+uint8_t led_warm_ticks = 0;
+void led_warm_tick(uint16_t ticks);
+#else
+#undef USE_LED_PREWARM
+#endif
+#ifdef USE_LED_PREWARM
+// power up the slow enable pins for a level, but leave the output dark
+void led_prewarm(uint8_t level);
+#endif
+
 #ifdef USE_SET_LEVEL_GRADUALLY
 // adjust brightness very smoothly
 uint8_t gradual_target;
@@ -171,6 +212,29 @@ uint8_t jump_start_level = DEFAULT_JUMP_START_LEVEL;
 #define RAMP_SIZE (sizeof(pwm1_levels)/sizeof(PWM_DATATYPE))
 #define MAX_LEVEL RAMP_SIZE
 
+#ifdef USE_POWER_LIMIT
+// cap output once a burst of high power has used up its energy budget,
+// before the heat even reaches the temperature sensor
+// estimated battery power at MAX_LEVEL, in watts * 10
+// (levels below that are scaled by LEVEL_LOAD)
+#ifndef POWER_AT_MAX_LEVEL
+#define POWER_AT_MAX_LEVEL 300
+#endif
+// power the host can get rid of indefinitely, in watts * 10
+#ifndef POWER_SUSTAINED
+#define POWER_SUSTAINED 50
+#endif
+// extra energy allowed above the sustained power, in joules (max 3000)
+#ifndef POWER_BURST_JOULES
+#define POWER_BURST_JOULES 300
+#endif
+// highest level allowed right now (255 means no limit)
+// (set_level() caps every mode to this, and steady_state also steps
+//  down to it gradually; other modes only see it on their next set_level())
+uint8_t power_limit_level = 255;
+void power_limit_tick(uint8_t ticks);
+#endif
+
 void set_level(uint8_t level);
 //void set_level_smooth(uint8_t level);
 
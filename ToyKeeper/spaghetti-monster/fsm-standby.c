@@ -27,40 +27,142 @@
 #include "fsm-wdt.h"
 #include "fsm-pcint.h"
 
+#ifdef USE_STANDBY_DEADLINE
+// ask for a wakeup within this many sleep ticks
+void standby_wake_within(uint16_t ticks) {
+    if (! ticks) ticks = 1;
+    if (ticks < standby_wake_ticks) standby_wake_ticks = ticks;
+}
+#endif
+
+#ifdef USE_RTC_WAKEUP
+// the RTC counts in awake-sized ticks, so a sleep tick is a few counts
+#define RTC_COUNTS_PER_SLEEP_TICK (1 << STANDBY_TICK_SPEED)
+// RTC compare match: acts like a sleep tick
+ISR(RTC_CNT_vect) {
+    RTC.INTFLAGS = RTC_CMP_bm | RTC_OVF_bm;
+    irq_wdt = 1;
+}
+#endif
+
 // low-power standby mode used while off but power still connected
 #define standby_mode sleep_until_eswitch_pressed
 void sleep_until_eswitch_pressed()
 {
-    #ifdef TICK_DURING_STANDBY
+    ADC_off();
+
+    #ifdef USE_POWER_GATING
+    // nothing lights up in standby, whatever the state asked for
+    power_gate_apply();
+    #endif
+
+    #ifdef USE_AUX_PWM
+    // timer0 stops while asleep, so dim aux LEDs use the pull-up instead
+    aux_pwm_sleep(1);
+    #endif
+
+    #ifdef USE_WDT_CALIBRATION
+    // re-measure the tick length once in a while,
+    // since the light may have warmed up or the battery drained
+    // (based on time, not how often it sleeps, since some modes
+    //  sleep between blinks)
+    // (after the ADC and aux PWM stop, and before the WDT slows down)
+    if (wdt_cal_age >= WDT_CAL_INTERVAL) wdt_calibrate();
+    #endif
+
+    #if defined(TICK_DURING_STANDBY) && !defined(USE_RTC_WAKEUP)
     WDT_slow();
     #else
     WDT_off();
     #endif
+    #ifdef USE_STANDBY_DEADLINE
+    standby_wake_ticks = 1;
+    #endif
+    #ifdef USE_RTC_WAKEUP
+    // where the most recent sleep tick was, in RTC counts
+    uint16_t rtc_last = RTC.CNT;
+    #endif
 
-    ADC_off();
+    #if defined(USE_LED_KEEP_WARM) && !defined(TICK_DURING_STANDBY)
+    // no ticks to end the keep-warm window, so end it now
+    led_warm_ticks = 0;
+    led_enable_off();
+    #endif
+
+    PCINT_on();  // wake on e-switch event
 
     // make sure switch isn't currently pressed
-    while (button_is_pressed()) {}
+    // (sleep until it's released instead of spinning, in case it's stuck)
+    while (button_is_pressed()) {
+        set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+        cli();
+        // (check again with interrupts off, so the release can't be missed)
+        if (button_is_pressed()) {
+            sleep_enable();
+            sei();  // (takes effect after the next instruction)
+            sleep_cpu();  // wait for the release edge, or a WDT tick
+            sleep_disable();
+        }
+        sei();
+    }
     empty_event_sequence();  // cancel pending input on suspend
 
-    PCINT_on();  // wake on e-switch event
-
     #ifdef TICK_DURING_STANDBY
     // detect which type of event caused a wake-up
     irq_adc = 0;
     irq_wdt = 0;
     irq_pcint = 0;
 
+    #ifdef USE_WARM_STANDBY
+    // sleep ticks left until the old measurements are stale
+    uint8_t warm = WARM_STANDBY_TICKS;
+    #else
     // reset voltage lowpass
     adc_reset = 1;
+    #endif
 
     while (go_to_standby) {
     #else
         go_to_standby = 0;
     #endif
 
+        #if defined(USE_SOC) && defined(USE_TICKLESS_STANDBY)
+        // nothing counts the time spent in a sleep with no ticks,
+        // so check on the next reading whether the battery rested
+        if ((STANDBY_WAKE_NONE == standby_wake_ticks) && (! soc_untimed)) {
+            soc_untimed = 1;
+            soc_sleep_voltage = voltage;
+        }
+        #endif
+
+        #ifdef USE_RTC_WAKEUP
+        #ifdef USE_TICKLESS_STANDBY
+        if (STANDBY_WAKE_NONE == standby_wake_ticks) {
+            // nothing to wake up for but the button
+            RTC.INTCTRL = 0;
+            set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+        } else
+        #endif
+        {
+            // schedule the next tick anything needs
+            // (if it's already late, wake up ASAP)
+            uint16_t next = rtc_last + (standby_wake_ticks * RTC_COUNTS_PER_SLEEP_TICK);
+            if ((int16_t)(next - RTC.CNT) < 1) next = RTC.CNT + 1;
+            while (RTC.STATUS & RTC_CMPBUSY_bm) {}
+            RTC.CMP = next;
+            RTC.INTFLAGS = RTC_CMP_bm;
+            RTC.INTCTRL = RTC_CMP_bm;
+            // the RTC doesn't run in power-down mode, only in standby
+            set_sleep_mode(SLEEP_MODE_STANDBY);
+        }
+        #else
+        #ifdef USE_TICKLESS_STANDBY
+        // slowest tick which meets the deadline, or none at all
+        WDT_deadline(standby_wake_ticks);
+        #endif
         // configure sleep mode
         set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+        #endif
 
         sleep_enable();
         #ifdef BODCR  // only do this on MCUs which support it
@@ -76,29 +178,74 @@ void sleep_until_eswitch_pressed()
         if (irq_pcint) {  // button pressed; wake up
             go_to_standby = 0;
         }
+        if (irq_wdt) {  // generate a sleep tick
+            #ifdef USE_RTC_WAKEUP
+            // count how many sleep ticks really passed
+            uint16_t ticks = (uint16_t)(RTC.CNT - rtc_last) / RTC_COUNTS_PER_SLEEP_TICK;
+            if (! ticks) ticks = 1;
+            rtc_last += ticks * RTC_COUNTS_PER_SLEEP_TICK;
+            if (ticks > 255) ticks = 255;
+            standby_ticks_elapsed = ticks;
+            #endif
+            #ifdef USE_WARM_STANDBY
+            uint8_t slept = 1;
+            #ifdef USE_STANDBY_DEADLINE
+            slept = standby_ticks_elapsed;
+            #endif
+            #endif
+            WDT_inner();
+            #ifdef USE_WARM_STANDBY
+            if (warm) {
+                warm = (slept < warm) ? (warm - slept) : 0;
+                // off long enough; forget the old measurements
+                if (! warm) adc_reset = 1;
+                #ifdef USE_STANDBY_DEADLINE
+                // (and make sure to wake up to notice)
+                else standby_wake_within(warm);
+                #endif
+            }
+            #endif
+        }
+        // (checked after the sleep tick, which may have taken a measurement)
         if (irq_adc) {  // ADC done measuring
             //adc_deferred_enable = 1;  // should already be 1
             #ifndef USE_LOWPASS_WHILE_ASLEEP
+            #ifdef USE_WARM_STANDBY
+            if (! warm)
+            #endif
             adc_reset = 1;  // use raw measurements while asleep
             #endif
             adc_deferred();
             //ADC_off();  // takes care of itself
             //irq_adc = 0;  // takes care of itself
         }
-        if (irq_wdt) {  // generate a sleep tick
-            WDT_inner();
-        }
     }
     #endif
 
     // don't lowpass immediately after waking
     // also, reset thermal history
+    #ifdef USE_WARM_STANDBY
+    // (unless it was only off for a moment, then the old data is still good)
+    if (! warm)
+    #endif
     adc_reset = 2;
 
+    #ifdef USE_AUX_PWM
+    aux_pwm_sleep(0);
+    #endif
+
+    #ifdef USE_POWER_GATING
+    // back to whatever the current state needs
+    power_gate_apply();
+    #endif
+
     // go back to normal running mode
     // PCINT not needed any more, and can cause problems if on
     // (occasional reboots on wakeup-by-button-press)
     PCINT_off();
+    #ifdef USE_RTC_WAKEUP
+    RTC.INTCTRL = 0;
+    #endif
     // restore normal awake-mode interrupts
     ADC_on();
     WDT_on();
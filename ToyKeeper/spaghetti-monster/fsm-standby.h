@@ -71,6 +71,67 @@ volatile uint8_t go_to_standby = 0;
 #define SLEEP_TICKS_PER_MINUTE 57
 
 #endif
+
+#if defined(USE_WDT_CALIBRATION) && (STANDBY_TICK_SPEED <= 6)
+// use the measured tick rate instead, for accurate long timers
+#undef SLEEP_TICKS_PER_MINUTE
+#define SLEEP_TICKS_PER_MINUTE (wdt_ticks_per_minute >> STANDBY_TICK_SPEED)
+#endif
+
+#ifdef USE_RTC_WAKEUP
+#ifndef AVRXMEGA3
+#error "USE_RTC_WAKEUP requires an attiny 1-series MCU"
+#endif
+#if (STANDBY_TICK_SPEED > 6)
+#error "USE_RTC_WAKEUP needs STANDBY_TICK_SPEED 6 or less"
+#endif
+// wake on an RTC compare match at the next tick anything needs,
+// instead of at every sleep tick
+#define USE_STANDBY_DEADLINE
+#endif
+
+#ifdef USE_TICKLESS_STANDBY
+#if (STANDBY_TICK_SPEED > 6)
+#error "USE_TICKLESS_STANDBY needs STANDBY_TICK_SPEED 6 or less"
+#endif
+// only wake up when something needs it, or not at all if nothing does
+// (the UI must ask for wakeups from its EV_sleep_tick handlers)
+#define USE_STANDBY_DEADLINE
+#endif
+
+#ifdef USE_WARM_STANDBY
+// if the light turns back on within this many sleep ticks,
+// keep the voltage lowpass and thermal history instead of starting over
+#ifndef WARM_STANDBY_TICKS
+#define WARM_STANDBY_TICKS (SLEEP_TICKS_PER_SECOND * 2)
+#endif
+#endif
+
+#ifdef USE_STANDBY_DEADLINE
+// longest time to sleep between wakeups, in sleep ticks (max 254)
+#ifndef STANDBY_WAKE_MAX
+#define STANDBY_WAKE_MAX 64
+#endif
+// nothing needs a wakeup; sleep until the button is pressed
+#define STANDBY_WAKE_NONE 255
+// sleep ticks until something needs to run again
+// (reset before each EV_sleep_tick, states lower it if they need to)
+uint8_t standby_wake_ticks = 1;
+// sleep ticks which passed since the previous EV_sleep_tick
+uint8_t standby_ticks_elapsed = 1;
+void standby_wake_within(uint16_t ticks);
+#ifdef USE_SLEEP_LVP
+// sleep ticks since the last battery check
+uint8_t sleep_lvp_ticks = 0;
+// wake up for the next battery check
+// (only needed while something drains power, like aux LEDs)
+#define standby_wake_for_lvp() standby_wake_within(64 - sleep_lvp_ticks)
+#endif
+#endif
+#endif
+
+#if defined(USE_WARM_STANDBY) && !defined(TICK_DURING_STANDBY)
+#error "USE_WARM_STANDBY requires TICK_DURING_STANDBY"
 #endif
 
 #define standby_mode sleep_until_eswitch_pressed
@@ -37,8 +37,15 @@ void _set_state(StatePtr new_state, uint16_t arg,
     if (current_state != NULL) current_state(exit_event, arg);
     // set new state
     current_state = new_state;
+    #ifdef USE_POWER_GATING
+    // the new state declares its own needs, if any
+    power_needs = 0;
+    #endif
     // call new state-enter hook (don't use stack)
     if (new_state != NULL) current_state(enter_event, arg);
+    #ifdef USE_POWER_GATING
+    power_gate_apply();
+    #endif
 
     // since state changed, stop any animation in progress
     interrupt_nice_delays();
@@ -100,6 +107,13 @@ uint8_t default_state(Event event, uint16_t arg) {
     }
     #endif
 
+    #if defined(USE_THERMAL_REGULATION) && defined(USE_THERM_MODEL)
+    else if (event == EV_temperature_target) {
+        therm_target(arg);
+        return EVENT_HANDLED;
+    }
+    #endif
+
     #if 0
     #ifdef USE_THERMAL_REGULATION
     else if (event == EV_temperature_high) {
@@ -22,6 +22,9 @@
 
 #include <avr/interrupt.h>
 #include <avr/wdt.h>
+#ifdef USE_WDT_CALIBRATION
+#include <util/delay_basic.h>
+#endif
 
 // *** Note for the AVRXMEGA3 (1-Series, eg 816 and 817), the WDT 
 // is not used for time-based interrupts.  A new peripheral, the 
@@ -48,6 +51,25 @@ void WDT_on()
     #endif
 }
 
+#if defined(USE_RTC_CRYSTAL) || defined(USE_RTC_WAKEUP)
+// set up the RTC clock source, and start the RTC counter if needed
+// (call once at boot, before WDT_on())
+void RTC_on() {
+    #ifdef USE_RTC_CRYSTAL
+    _PROTECTED_WRITE(CLKCTRL.XOSC32KCTRLA,
+                     CLKCTRL_ENABLE_bm | CLKCTRL_RUNSTDBY_bm | CLKCTRL_CSUT_1K_gc);
+    while (RTC.STATUS > 0) {}
+    RTC.CLKSEL = RTC_CLKSEL_TOSC32K_gc;
+    #endif
+    #ifdef USE_RTC_WAKEUP
+    // count in awake-sized ticks, and keep counting while asleep
+    while (RTC.STATUS > 0) {}
+    RTC.PER = 0xffff;
+    RTC.CTRLA = RTC_PRESCALER_DIV512_gc | RTC_RUNSTDBY_bm | RTC_RTCEN_bm;
+    #endif
+}
+#endif
+
 #ifdef TICK_DURING_STANDBY
 inline void WDT_slow()
 {
@@ -71,6 +93,49 @@ inline void WDT_slow()
 }
 #endif
 
+#ifdef USE_TICKLESS_STANDBY
+// set the slowest standby tick which still wakes up by the deadline,
+// or turn the WDT off if there is no deadline
+// (doesn't apply to USE_RTC_WAKEUP, which wakes at exactly the deadline)
+void WDT_deadline(uint8_t ticks) {
+    if (STANDBY_WAKE_NONE == ticks) {
+        WDT_off();
+        return;
+    }
+
+    // period is 16ms << speed
+    #ifdef AVRXMEGA3
+    #define WDT_MAX_SPEED 6  // 1 s
+    #else
+    #define WDT_MAX_SPEED 9  // 8 s
+    #endif
+    uint8_t speed = STANDBY_TICK_SPEED;
+    uint8_t n = 1;
+    while ((speed < WDT_MAX_SPEED) && ((n << 1) <= ticks)) {
+        speed ++;
+        n <<= 1;
+    }
+    // each wakeup counts as this many sleep ticks
+    standby_ticks_elapsed = n;
+
+    #if (ATTINY == 25) || (ATTINY == 45) || (ATTINY == 85)
+        // (the top bit is separate from the others)
+        wdt_reset();
+        WDTCR |= (1<<WDCE) | (1<<WDE);
+        WDTCR = (1<<WDIE) | (speed & 7) | ((speed & 8) << 2);
+    #elif (ATTINY == 1634)
+        wdt_reset();
+        WDTCSR = (1<<WDIE) | (speed & 7) | ((speed & 8) << 2);
+    #elif defined(AVRXMEGA3)  // ATTINY816, 817, etc
+        RTC.PITINTCTRL = RTC_PI_bm;
+        while (RTC.PITSTATUS > 0) {}
+        RTC.PITCTRLA = (1<<6) | (speed<<3) | RTC_PITEN_bm;
+    #else
+        #error Unrecognized MCU type
+    #endif
+}
+#endif
+
 inline void WDT_off()
 {
     #if (ATTINY == 25) || (ATTINY == 45) || (ATTINY == 85)
@@ -95,6 +160,62 @@ inline void WDT_off()
     #endif
 }
 
+#ifdef USE_WDT_CALIBRATION
+// the tick's interrupt flag, for polling with interrupts off
+#if (ATTINY == 25) || (ATTINY == 45) || (ATTINY == 85)
+#define WDT_CAL_FLAG() (WDTCR & (1<<WDIF))
+#define WDT_CAL_CLEAR() (WDTCR = (1<<WDIE) | (1<<WDIF))
+#elif (ATTINY == 1634)
+#define WDT_CAL_FLAG() (WDTCSR & (1<<WDIF))
+#define WDT_CAL_CLEAR() (WDTCSR = (1<<WDIE) | (1<<WDIF))
+#elif defined(AVRXMEGA3)  // ATTINY816, 817, etc
+#define WDT_CAL_FLAG() (RTC.PITINTFLAGS & RTC_PI_bm)
+#define WDT_CAL_CLEAR() (RTC.PITINTFLAGS = RTC_PI_bm)
+#endif
+
+// count main clock time across a few ticks, to find the real tick length
+// (blocks for ~80ms, and needs the WDT at 16ms)
+// (polls the tick with interrupts off, since any other interrupt
+//  would steal time from the count)
+void wdt_calibrate() {
+    #define WDT_CAL_TICKS 4
+    // 32us per chunk, minus ~8 cycles of loop overhead
+    #define WDT_CAL_CHUNK ((F_CPU / 125000) - 2)
+    uint16_t chunks = 0;
+
+    #ifdef USE_DYNAMIC_UNDERCLOCKING
+    clock_prescale_set(clock_div_1);
+    #endif
+
+    uint8_t sreg = SREG;
+    cli();
+    // start at a tick boundary
+    WDT_CAL_CLEAR();
+    while (! WDT_CAL_FLAG()) {}
+    for (uint8_t i=0; i<WDT_CAL_TICKS; i++) {
+        WDT_CAL_CLEAR();
+        while (! WDT_CAL_FLAG()) {
+            _delay_loop_2(WDT_CAL_CHUNK);
+            chunks ++;
+        }
+    }
+    WDT_CAL_CLEAR();
+    SREG = sreg;
+    irq_wdt = 0;
+    wdt_cal_age = 0;
+
+    #ifdef USE_DYNAMIC_UNDERCLOCKING
+    auto_clock_speed();
+    #endif
+
+    // ticks per minute = 60 s / (chunks * 32us / WDT_CAL_TICKS)
+    // (ignore anything too far off to be real, like from a slow clock)
+    #define WDT_CAL_NOMINAL (500 * WDT_CAL_TICKS)
+    if ((chunks > (WDT_CAL_NOMINAL*3/4)) && (chunks < (WDT_CAL_NOMINAL*5/4)))
+        wdt_ticks_per_minute = (uint32_t)(60000000 / 32) * WDT_CAL_TICKS / chunks;
+}
+#endif
+
 // clock tick -- this runs every 16ms (62.5 fps)
 #ifdef AVRXMEGA3  // ATTINY816, 817, etc
 ISR(RTC_PIT_vect) {
@@ -110,10 +231,31 @@ void WDT_inner() {
 
     static uint8_t adc_trigger = 0;
 
+    // how many ticks passed since last time?
+    uint8_t elapsed = 1;
+    #ifdef USE_STANDBY_DEADLINE
+    // (in standby, it may skip ticks nothing needed)
+    if (go_to_standby) elapsed = standby_ticks_elapsed;
+    standby_ticks_elapsed = 1;
+    #endif
+
+    #ifdef USE_WDT_CALIBRATION
+    {
+        // keep track of how stale the calibration is
+        uint16_t t = elapsed;
+        #ifdef TICK_DURING_STANDBY
+        if (go_to_standby) t <<= STANDBY_TICK_SPEED;
+        #endif
+        uint16_t age = wdt_cal_age + t;
+        if (age < t) age = 0xffff;
+        wdt_cal_age = age;
+    }
+    #endif
+
     // cache this here to reduce ROM size, because it's volatile
     uint16_t ticks_since_last = ticks_since_last_event;
     // increment, but loop from max back to half
-    ticks_since_last = (ticks_since_last + 1) \
+    ticks_since_last = (ticks_since_last + elapsed) \
                      | (ticks_since_last & 0x8000);
     // copy back to the original
     ticks_since_last_event = ticks_since_last;
@@ -131,19 +273,64 @@ void WDT_inner() {
     #ifdef TICK_DURING_STANDBY
     // handle standby mode specially
     if (go_to_standby) {
+        #ifdef USE_STANDBY_DEADLINE
+        // states ask for an earlier wakeup, if they need one
+        #ifdef USE_TICKLESS_STANDBY
+        standby_wake_ticks = STANDBY_WAKE_NONE;
+        #else
+        standby_wake_ticks = STANDBY_WAKE_MAX;
+        #endif
+        #endif
+
         // emit a sleep tick, and process it
         emit(EV_sleep_tick, ticks_since_last);
         process_emissions();
 
-        #ifndef USE_SLEEP_LVP
-        return;  // no sleep LVP needed if nothing drains power while off
-        #else
-        // stop here, usually...  but proceed often enough for sleep LVP to work
-        if (0 != (ticks_since_last & 0x3f)) return;
+        #if defined(USE_POWER_LIMIT) || defined(USE_SOC)
+        for (uint8_t i = elapsed; i; i--) {
+            #ifdef USE_POWER_LIMIT
+            // let the power budget recover while off
+            power_limit_tick(1 << STANDBY_TICK_SPEED);
+            #endif
+            #ifdef USE_SOC
+            soc_tick(1 << STANDBY_TICK_SPEED);
+            #endif
+        }
+        #ifdef USE_STANDBY_DEADLINE
+        // these need to know how much time passed
+        #ifdef USE_POWER_LIMIT
+        if (power_limit_level != 255) standby_wake_within(STANDBY_WAKE_MAX);
+        #endif
+        #endif
+        #endif
 
-        adc_trigger = 0;  // make sure a measurement will happen
-        ADC_on();  // enable ADC voltage measurement functions temporarily
+        #ifdef USE_LED_KEEP_WARM
+        // power down the regulator once it's no longer likely to be needed
+        led_warm_tick((uint16_t)elapsed << STANDBY_TICK_SPEED);
+        #ifdef USE_STANDBY_DEADLINE
+        if (led_warm_ticks)
+            standby_wake_within(led_warm_ticks >> STANDBY_TICK_SPEED);
+        #endif
         #endif
+
+        #ifdef USE_SLEEP_LVP
+        // measure the battery often enough for sleep LVP to work
+        // (no sleep LVP needed if nothing drains power while off)
+        #ifdef USE_STANDBY_DEADLINE
+        // (states ask for wakeups with standby_wake_for_lvp() if needed)
+        sleep_lvp_ticks += elapsed;
+        if (sleep_lvp_ticks >= 64) {
+            sleep_lvp_ticks = 0;
+            ADC_sleep_measurement();
+        }
+        #else
+        if (0 == (ticks_since_last & 0x3f)) {
+            // one quick reading, then the ADC goes right back off
+            ADC_sleep_measurement();
+        }
+        #endif
+        #endif
+        return;
     }
     else {  // button handling should only happen while awake
     #endif
@@ -152,6 +339,17 @@ void WDT_inner() {
     // append timeout to current event sequence, then
     // send event to current state callback
 
+    #ifdef USE_POWER_LIMIT
+    power_limit_tick(1);
+    #endif
+    #ifdef USE_SOC
+    soc_tick(1);
+    #endif
+
+    #ifdef USE_LED_KEEP_WARM
+    led_warm_tick(1);
+    #endif
+
     // callback on each timer tick
     if ((current_event & B_FLAGS) == (B_CLICK | B_HOLD | B_PRESS)) {
         emit(EV_tick, 0);  // override tick counter while holding button
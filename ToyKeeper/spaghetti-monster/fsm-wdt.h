@@ -27,6 +27,44 @@ inline void WDT_off();
 
 volatile uint8_t irq_wdt = 0;  // WDT interrupt happened?
 
+#ifdef USE_RTC_CRYSTAL
+#ifndef AVRXMEGA3
+#error "USE_RTC_CRYSTAL requires an attiny 1-series MCU"
+#endif
+// clock the RTC and PIT from an external 32.768 kHz crystal on TOSC1/TOSC2
+// (the hwdef must leave those pins alone)
+// ... which is accurate enough to need no calibration
+#undef USE_WDT_CALIBRATION
+#endif
+#if defined(USE_RTC_CRYSTAL) || defined(USE_RTC_WAKEUP)
+void RTC_on();
+#endif
+
+#ifdef USE_WDT_CALIBRATION
+// the WDT oscillator can be off by 10% or more, depending on temperature
+// and voltage, so measure it against the main clock once in a while
+// real ticks per minute, measured
+#ifdef AVRXMEGA3  // PIT: 512 cycles of 32768 Hz
+uint16_t wdt_ticks_per_minute = 3840;
+#else  // WDT: nominally 16 ms
+uint16_t wdt_ticks_per_minute = 3750;
+#endif
+void wdt_calibrate();
+// it takes ~80 ms of busy-waiting, so only redo it this often
+// (in awake-sized ticks; max 65535)
+#ifndef WDT_CAL_INTERVAL
+#define WDT_CAL_INTERVAL (TICKS_PER_SECOND * 60 * 10)
+#endif
+// ticks since the last calibration (stops at 65535)
+uint16_t wdt_cal_age = 0;
+// per-second accumulators count in 1/60ths of a tick, to stay exact
+#define CAL_TICKS(t) ((t) * 60)
+#define CAL_TICKS_PER_SECOND wdt_ticks_per_minute
+#else
+#define CAL_TICKS(t) (t)
+#define CAL_TICKS_PER_SECOND TICKS_PER_SECOND
+#endif
+
 #ifdef TICK_DURING_STANDBY
   #if defined(USE_INDICATOR_LED) || defined(USE_AUX_RGB_LEDS)
   // measure battery charge while asleep
@@ -34,4 +72,13 @@ volatile uint8_t irq_wdt = 0;  // WDT interrupt happened?
   #endif
 #endif
 
+#ifdef USE_TICKLESS_STANDBY
+void WDT_deadline(uint8_t ticks);
+#endif
+
+#ifdef USE_SLEEP_LVP
+// take a single low-power voltage reading (in fsm-adc.c)
+void ADC_sleep_measurement();
+#endif
+
 #endif